@@ -0,0 +1,157 @@
+#include "compare.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "Random.h"
+
+void Baseline::add(const std::string& scenario, double value) {
+    m_samples[scenario].push_back(value);
+}
+
+const std::vector<double>* Baseline::samples(
+    const std::string& scenario) const {
+    auto it = m_samples.find(scenario);
+    return it == m_samples.end() ? nullptr : &it->second;
+}
+
+bool Baseline::save(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << std::fixed << std::setprecision(1) << "{";
+    bool first = true;
+    for (auto& [scenario, values] : m_samples) {
+        out << (first ? "\n" : ",\n") << "  \"" << scenario << "\": [";
+        for (size_t i = 0; i < values.size(); i++)
+            out << (i ? ", " : "") << values[i];
+        out << "]";
+        first = false;
+    }
+    out << "\n}\n";
+    return (bool)out;
+}
+
+bool Baseline::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    const std::string text = buffer.str();
+
+    m_samples.clear();
+    size_t at = 0;
+    auto skip = [&] {
+        while (at < text.size() && isspace((unsigned char)text[at])) at++;
+    };
+    auto expect = [&](char c) {
+        skip();
+        if (at >= text.size() || text[at] != c) return false;
+        at++;
+        return true;
+    };
+
+    if (!expect('{')) return false;
+    skip();
+    if (at < text.size() && text[at] == '}') return true;
+    do {
+        if (!expect('"')) return false;
+        size_t end = text.find('"', at);
+        if (end == std::string::npos) return false;
+        std::string scenario = text.substr(at, end - at);
+        at = end + 1;
+        if (!expect(':') || !expect('[')) return false;
+        std::vector<double>& values = m_samples[scenario];
+        skip();
+        if (at < text.size() && text[at] == ']') {
+            at++;
+            continue;
+        }
+        do {
+            skip();
+            char* next;
+            double value = strtod(text.c_str() + at, &next);
+            if (next == text.c_str() + at) return false;
+            values.push_back(value);
+            at = next - text.c_str();
+        } while (expect(','));
+        if (!expect(']')) return false;
+    } while (expect(','));
+    return expect('}');
+}
+
+double median(std::vector<double> values) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+double mannWhitneyLess(const std::vector<double>& current,
+                       const std::vector<double>& baseline) {
+    size_t m = current.size(), n = baseline.size();
+    if (m == 0 || n == 0) return 1;
+
+    // U counts the pairs in which current is the larger value, ties as half.
+    double u = 0;
+    bool ties = false;
+    for (double c : current) {
+        for (double b : baseline) {
+            if (c > b) u += 1;
+            if (c == b) {
+                u += 0.5;
+                ties = true;
+            }
+        }
+    }
+
+    if (!ties && m * n <= 400) {
+        // ways[k][u]: orderings of k current and j baseline values with
+        // statistic u, built up one baseline value at a time. The largest
+        // value is either a baseline one, adding nothing to u, or a current
+        // one, which beats all j baseline values.
+        std::vector<std::vector<double>> ways(
+            m + 1, std::vector<double>(m * n + 1, 0));
+        for (size_t k = 0; k <= m; k++) ways[k][0] = 1;
+        for (size_t j = 1; j <= n; j++) {
+            std::vector<std::vector<double>> next(
+                m + 1, std::vector<double>(m * n + 1, 0));
+            next[0][0] = 1;
+            for (size_t k = 1; k <= m; k++)
+                for (size_t v = 0; v <= m * n; v++)
+                    next[k][v] = ways[k][v] + (v >= j ? next[k - 1][v - j] : 0);
+            ways.swap(next);
+        }
+        double total = 0, below = 0;
+        for (size_t v = 0; v <= m * n; v++) {
+            total += ways[m][v];
+            if (v <= u) below += ways[m][v];
+        }
+        return below / total;
+    }
+
+    double mean = m * n / 2.0;
+    double sigma = std::sqrt(m * n * (m + n + 1) / 12.0);
+    double z = (u + 0.5 - mean) / sigma;
+    return 0.5 * std::erfc(-z / std::sqrt(2.0));
+}
+
+void bootstrapRatio(const std::vector<double>& current,
+                    const std::vector<double>& baseline, uint64_t seed,
+                    double& low, double& high) {
+    const int RESAMPLES = 2000;
+    RandomStream random(seed);
+    std::vector<double> ratios, a(current.size()), b(baseline.size());
+    for (int r = 0; r < RESAMPLES; r++) {
+        for (auto& x : a) x = current[random.range(0, current.size() - 1)];
+        for (auto& x : b) x = baseline[random.range(0, baseline.size() - 1)];
+        ratios.push_back(median(a) / median(b));
+    }
+    std::sort(ratios.begin(), ratios.end());
+    low = ratios[RESAMPLES * 25 / 1000];
+    high = ratios[RESAMPLES * 975 / 1000];
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Ticks per second of repeated benchmark runs, per scenario, saved as a JSON
+// object that maps each scenario name to its array of samples.
+class Baseline {
+    std::map<std::string, std::vector<double>> m_samples;
+
+   public:
+    void add(const std::string& scenario, double value);
+    const std::vector<double>* samples(const std::string& scenario) const;
+
+    bool save(const std::string& path) const;
+    // Reads the format save() writes. Returns false if the file is missing
+    // or malformed.
+    bool load(const std::string& path);
+};
+
+double median(std::vector<double> values);
+
+// One-sided Mann-Whitney U test: the probability of current ranking this
+// low against baseline if both came from the same distribution. Exact for
+// small samples without ties, normal approximation otherwise.
+double mannWhitneyLess(const std::vector<double>& current,
+                       const std::vector<double>& baseline);
+
+// Bootstrap 95% confidence interval of median(current) / median(baseline).
+void bootstrapRatio(const std::vector<double>& current,
+                    const std::vector<double>& baseline, uint64_t seed,
+                    double& low, double& high);
@@ -0,0 +1,78 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "EntityManager.h"
+#include "JobSystem.h"
+
+// Scaling benchmark for the job system. Runs the per-entity work of
+// Game::sMovement over 1k, 10k and 100k entities (or the counts given on
+// the command line), serially and with 1, 2, 4, 8 and 16 threads.
+
+static void move(Entity& e) {
+    CTransform& t = *e.cTransform;
+    t.pos += t.velocity.normalize() * t.speed;
+    if (t.velocity.x < 0)
+        t.velocity.x = std::min((float)0, t.velocity.x + t.friction);
+    else
+        t.velocity.x = std::max((float)0, t.velocity.x - t.friction);
+    if (t.velocity.y < 0)
+        t.velocity.y = std::min((float)0, t.velocity.y + t.friction);
+    else
+        t.velocity.y = std::max((float)0, t.velocity.y - t.friction);
+    t.angle++;
+}
+
+template <class F>
+static double microsecondsPerRun(int reps, F&& f) {
+    for (int i = 0; i < reps / 10 + 1; i++) f();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; i++) f();
+    std::chrono::duration<double, std::micro> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() / reps;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<size_t> counts = {1000, 10000, 100000};
+    if (argc > 1) {
+        counts.clear();
+        for (int i = 1; i < argc; i++) counts.push_back(atol(argv[i]));
+    }
+    const size_t threads[] = {1, 2, 4, 8, 16};
+
+    printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+    printf("%10s %8s %12s %8s\n", "entities", "threads", "us/run", "speedup");
+
+    for (size_t n : counts) {
+        EntityManager manager;
+        for (size_t i = 0; i < n; i++) {
+            auto e = manager.addEntity("enemy");
+            e->cTransform = std::make_shared<CTransform>(
+                Vec2(i % 1920, i % 1080), Vec2(1 + i % 7, 1 + i % 5), 0, 0.01,
+                3);
+        }
+        manager.update();
+        const EntityVec& entities = manager.getEntities();
+        int reps = std::max((size_t)20, 20000000 / std::max((size_t)1, n));
+
+        double serial = microsecondsPerRun(reps, [&] {
+            for (auto& e : entities) move(*e);
+        });
+        printf("%10zu %8s %12.2f %8.2f\n", n, "serial", serial, 1.0);
+
+        for (size_t t : threads) {
+            JobSystem jobs(t);
+            double time = microsecondsPerRun(reps, [&] {
+                jobs.parallelFor(0, entities.size(), 256,
+                                 [&](size_t begin, size_t end) {
+                                     for (size_t i = begin; i < end; i++)
+                                         move(*entities[i]);
+                                 });
+            });
+            printf("%10zu %8zu %12.2f %8.2f\n", n, t, time, serial / time);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "EntityManager.h"
+#include "Vec2.h"
+#include "microbench.h"
+
+// Microbenchmarks of the building blocks the systems spend their time in.
+//
+//     bench_micro [--list] [--reps N] [filter...]
+
+static const char* TAGS[] = {"player", "enemy", "bullet", "minienemie",
+                             "specialbullet"};
+
+static std::vector<Vec2> points(size_t n, float scale) {
+    std::vector<Vec2> v;
+    for (size_t i = 0; i < n; i++)
+        v.push_back(
+            Vec2((i * 7919) % 1920 * scale, (i * 104729) % 1080 * scale));
+    return v;
+}
+
+static void fill(EntityManager& manager, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        auto e = manager.addEntity(TAGS[i % 5]);
+        e->cTransform = std::make_shared<CTransform>(Vec2(i, i), Vec2(1, 1), 0,
+                                                     0, 1);
+    }
+    manager.update();
+}
+
+static void vec2Benchmarks(std::vector<Microbenchmark>& out) {
+    const size_t N = 1024;
+    out.push_back({"vec2/add", [](BenchState& state) {
+                       auto a = points(N, 1), b = points(N, 0.5);
+                       state.items = N;
+                       while (state.keepRunning()) {
+                           for (size_t i = 0; i < N; i++) a[i] += b[i];
+                           clobberMemory();
+                       }
+                   }});
+    out.push_back({"vec2/normalize", [](BenchState& state) {
+                       auto a = points(N, 1);
+                       state.items = N;
+                       while (state.keepRunning()) {
+                           for (size_t i = 0; i < N; i++)
+                               doNotOptimize(a[i].normalize());
+                       }
+                   }});
+    out.push_back({"vec2/dist", [](BenchState& state) {
+                       auto a = points(N, 1), b = points(N, 0.5);
+                       state.items = N;
+                       while (state.keepRunning()) {
+                           for (size_t i = 0; i < N; i++)
+                               doNotOptimize(a[i].dist(b[i]));
+                       }
+                   }});
+}
+
+static void managerBenchmarks(std::vector<Microbenchmark>& out) {
+    // Steady churn: a batch of entities is added, lives for one update and
+    // is removed by the next.
+    for (size_t n : {100, 1000}) {
+        out.push_back(
+            {"manager/add_update/" + std::to_string(n),
+             [n](BenchState& state) {
+                 EntityManager manager;
+                 fill(manager, 1000);
+                 state.items = n;
+                 while (state.keepRunning()) {
+                     EntityVec batch;
+                     for (size_t i = 0; i < n; i++)
+                         batch.push_back(manager.addEntity(TAGS[i % 5]));
+                     manager.update();
+                     for (auto& e : batch) e->destroy();
+                     manager.update();
+                 }
+             }});
+    }
+
+    // One update() over 10000 live entities of which a share was destroyed.
+    for (int percent : {0, 1, 10, 50, 90}) {
+        out.push_back(
+            {"manager/remove_dead/" + std::to_string(percent) + "%",
+             [percent](BenchState& state) {
+                 const size_t N = 10000;
+                 state.items = N;
+                 std::unique_ptr<EntityManager> manager;
+                 while (state.keepRunning()) {
+                     state.pause();
+                     manager = std::make_unique<EntityManager>();
+                     fill(*manager, N);
+                     const EntityVec& entities = manager->getEntities();
+                     for (size_t i = 0; i < N; i++)
+                         if ((i * 37) % 100 < (size_t)percent)
+                             entities[i]->destroy();
+                     state.resume();
+                     manager->update();
+                 }
+             }});
+    }
+
+    // The systems look tags up with string literals, which builds a
+    // std::string on every call.
+    out.push_back({"manager/tag_lookup/literal", [](BenchState& state) {
+                       EntityManager manager;
+                       fill(manager, 1000);
+                       while (state.keepRunning())
+                           doNotOptimize(manager.getEntities("minienemie"));
+                   }});
+    out.push_back({"manager/tag_lookup/string", [](BenchState& state) {
+                       EntityManager manager;
+                       fill(manager, 1000);
+                       const std::string tag = "minienemie";
+                       while (state.keepRunning())
+                           doNotOptimize(manager.getEntities(tag));
+                   }});
+}
+
+// Every pair of n circles against each other, the way sCollision tests
+// bullets against enemies.
+static void circleBenchmarks(std::vector<Microbenchmark>& out) {
+    const size_t N = 256;
+    out.push_back({"circles/dist", [](BenchState& state) {
+                       auto a = points(N, 1), b = points(N, 0.5);
+                       const float ra = 10, rb = 32;
+                       state.items = N * N;
+                       while (state.keepRunning()) {
+                           int hits = 0;
+                           for (size_t i = 0; i < N; i++)
+                               for (size_t j = 0; j < N; j++)
+                                   hits += a[i].dist(b[j]) <= ra + rb;
+                           doNotOptimize(hits);
+                       }
+                   }});
+    out.push_back({"circles/squared", [](BenchState& state) {
+                       auto a = points(N, 1), b = points(N, 0.5);
+                       const float ra = 10, rb = 32;
+                       state.items = N * N;
+                       while (state.keepRunning()) {
+                           int hits = 0;
+                           for (size_t i = 0; i < N; i++) {
+                               for (size_t j = 0; j < N; j++) {
+                                   float dx = a[i].x - b[j].x;
+                                   float dy = a[i].y - b[j].y;
+                                   hits += dx * dx + dy * dy <=
+                                           (ra + rb) * (ra + rb);
+                               }
+                           }
+                           doNotOptimize(hits);
+                       }
+                   }});
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<Microbenchmark> benchmarks;
+    vec2Benchmarks(benchmarks);
+    managerBenchmarks(benchmarks);
+    circleBenchmarks(benchmarks);
+    return runMicrobenchmarks(benchmarks, argc, argv);
+}
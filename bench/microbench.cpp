@@ -0,0 +1,106 @@
+#include "microbench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+uint64_t benchNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+BenchState::BenchState(uint64_t iterations)
+    : m_iterations(iterations), m_remaining(iterations) {}
+
+uint64_t BenchState::iterations() const { return m_iterations; }
+
+void BenchState::pause() { m_pausedAt = benchNow(); }
+
+void BenchState::resume() { m_paused += benchNow() - m_pausedAt; }
+
+uint64_t BenchState::elapsedNanoseconds() const {
+    return m_end - m_start - m_paused;
+}
+
+struct Sample {
+    double nanoseconds;  // per iteration
+    size_t items;
+};
+
+static Sample measure(const Microbenchmark& benchmark, uint64_t iterations) {
+    BenchState state(iterations);
+    benchmark.run(state);
+    return {(double)state.elapsedNanoseconds() / iterations, state.items};
+}
+
+// Each timed run should take about this long.
+static const double TARGET_NANOSECONDS = 10e6;
+
+static void run(const Microbenchmark& benchmark, int reps) {
+    // Warm up and calibrate: grow the iteration count until a run takes at
+    // least a tenth of the target.
+    uint64_t iterations = 1;
+    Sample sample = measure(benchmark, iterations);
+    while (sample.nanoseconds * iterations < TARGET_NANOSECONDS / 10 &&
+           iterations < ((uint64_t)1 << 40)) {
+        iterations *= 10;
+        sample = measure(benchmark, iterations);
+    }
+    iterations = std::max<uint64_t>(
+        1, TARGET_NANOSECONDS / std::max(sample.nanoseconds, 1e-3));
+
+    std::vector<double> times;
+    for (int i = 0; i < reps; i++) {
+        sample = measure(benchmark, iterations);
+        times.push_back(sample.nanoseconds);
+    }
+    std::sort(times.begin(), times.end());
+    double mean = 0;
+    for (double t : times) mean += t;
+    mean /= times.size();
+    double variance = 0;
+    for (double t : times) variance += (t - mean) * (t - mean);
+    double stddev = std::sqrt(variance / times.size());
+    double median = times[times.size() / 2];
+
+    printf("%-32s %12llu %14.2f %14.2f %7.1f%% %12.3f\n",
+           benchmark.name.c_str(), (unsigned long long)iterations, median,
+           times[0], 100 * stddev / mean, median / sample.items);
+}
+
+int runMicrobenchmarks(const std::vector<Microbenchmark>& benchmarks,
+                       int argc, char* argv[]) {
+    int reps = 15;
+    std::vector<std::string> filter;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--list") == 0) {
+            for (auto& b : benchmarks) printf("%s\n", b.name.c_str());
+            return 0;
+        } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = std::max(1, atoi(argv[++i]));
+        } else {
+            filter.push_back(argv[i]);
+        }
+    }
+
+    std::vector<const Microbenchmark*> selected;
+    for (auto& b : benchmarks) {
+        bool match = filter.empty();
+        for (auto& f : filter)
+            if (b.name.find(f) != std::string::npos) match = true;
+        if (match) selected.push_back(&b);
+    }
+    if (selected.empty()) {
+        fprintf(stderr, "no benchmark matches\n");
+        return 1;
+    }
+
+    printf("%-32s %12s %14s %14s %8s %12s\n", "benchmark", "iterations",
+           "median ns", "min ns", "stddev", "ns/item");
+    for (auto* b : selected) run(*b, reps);
+    return 0;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A small microbenchmark harness. Each benchmark is a function that does its
+// setup, then runs its body in a while (state.keepRunning()) loop; only the
+// loop is timed. The harness first grows the iteration count until one run
+// is long enough to time, then times a number of runs and reports the
+// median, min and spread per iteration.
+
+// Keeps the compiler from discarding a value, or a store, it can prove is
+// unused.
+template <class T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+inline void clobberMemory() { asm volatile("" : : : "memory"); }
+
+uint64_t benchNow();
+
+class BenchState {
+    uint64_t m_iterations;
+    uint64_t m_remaining;
+    uint64_t m_start = 0, m_end = 0;
+    uint64_t m_pausedAt = 0;
+    uint64_t m_paused = 0;
+
+   public:
+    // Work items per iteration, to report the time per item as well.
+    size_t items = 1;
+
+    BenchState(uint64_t iterations);
+    uint64_t iterations() const;
+
+    // Starts the clock on the first call and stops it once the body has run
+    // iterations() times. Inline, so it adds little to short bodies.
+    bool keepRunning() {
+        if (m_remaining == m_iterations) m_start = benchNow();
+        if (m_remaining == 0) {
+            m_end = benchNow();
+            return false;
+        }
+        m_remaining--;
+        return true;
+    }
+    uint64_t elapsedNanoseconds() const;
+
+    // Time between pause() and resume() is not counted, for setup that has
+    // to happen inside the loop.
+    void pause();
+    void resume();
+};
+
+struct Microbenchmark {
+    std::string name;
+    std::function<void(BenchState&)> run;
+};
+
+// Runs the benchmarks whose name contains one of the filter arguments, or
+// all of them. --list prints the names, --reps N sets the timed runs.
+int runMicrobenchmarks(const std::vector<Microbenchmark>& benchmarks,
+                       int argc, char* argv[]);
@@ -0,0 +1,287 @@
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Game.h"
+#include "Profiler.h"
+#include "compare.h"
+
+// Headless stress scenarios. Each one runs in a child process, so that its
+// peak RSS is its own, and prints one JSON object with the tick rate, the
+// p50 and p99 of every profiling zone per tick and the peak RSS. The parent
+// collects them into a JSON array on stdout; progress goes to stderr.
+//
+// With --perf-counters, zones also report IPC and cache and branch misses
+// per entity, if the hardware counters can be opened. Reading them costs two
+// syscalls per zone, so the timings are not comparable with runs without.
+//
+// --repeat N runs every scenario N times, round robin so that drift of the
+// machine spreads over all of them. --save-baseline writes the tick rates of
+// the runs to a baseline file; --baseline compares them with one. A scenario
+// regressed if its median tick rate dropped by more than --threshold percent
+// and a one-sided Mann-Whitney U test puts the drop below a p of 0.05, which
+// needs at least 5 runs on both sides. The exit code is then 2.
+//
+//     bench_scenarios [--ticks N] [--perf-counters] [--repeat N]
+//                     [--save-baseline PATH | --baseline PATH]
+//                     [--threshold PCT] [scenario...]
+
+struct Scenario {
+    const char* name;
+    int enemies;  // topped up before every tick
+    int ticks;
+    void (*tick)(Game& game, RandomStream& random);
+};
+
+static Vec2 randomPoint(Game& game, RandomStream& random) {
+    Vec2 size = game.worldSize();
+    return Vec2(random.uniform() * size.x, random.uniform() * size.y);
+}
+
+static const Scenario SCENARIOS[] = {
+    {"enemies_1k", 1000, 600, nullptr},
+    {"enemies_10k", 10000, 600, nullptr},
+    {"enemies_100k", 100000, 120, nullptr},
+    {"bullet_stream", 1000, 600,
+     [](Game& game, RandomStream& random) {
+         for (int i = 0; i < 20; i++)
+             game.spawnBullet(randomPoint(game, random));
+     }},
+    {"shard_explosions", 2000, 600,
+     [](Game& game, RandomStream&) { game.explodeEnemies(20); }},
+    {"special_storm", 1000, 600,
+     [](Game& game, RandomStream& random) {
+         for (int i = 0; i < 10; i++)
+             game.spawnSpecialBullet(randomPoint(game, random));
+     }},
+};
+
+static const int WARMUP_TICKS = 120;
+
+static double percentile(std::vector<float>& samples, double p) {
+    if (samples.empty()) return 0;
+    size_t i = std::min(samples.size() - 1, (size_t)(samples.size() * p));
+    std::nth_element(samples.begin(), samples.begin() + i, samples.end());
+    return samples[i];
+}
+
+static void runScenario(const Scenario& scenario, int ticks, bool counters,
+                        FILE* out) {
+    GameOptions options;
+    options.config = "config.txt";
+    options.headless = true;
+    options.seed = 1;
+    options.perfCounters = counters;
+    auto game = std::make_unique<Game>(options);
+    RandomStream random(options.seed, 1);
+    Profiler& profiler = Profiler::get();
+    game->start();
+
+    std::vector<std::vector<float>> samples;
+    std::vector<Profiler::CounterStats> totals;
+    double seconds = 0;
+    for (int t = 0; t < WARMUP_TICKS + ticks; t++) {
+        size_t enemies = game->entityCount("enemy");
+        for (size_t n = enemies; n < (size_t)scenario.enemies; n++)
+            game->spawnEnemy();
+        if (scenario.tick) scenario.tick(*game, random);
+
+        auto start = std::chrono::steady_clock::now();
+        game->step();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        profiler.endFrame();
+        if (t < WARMUP_TICKS) continue;
+
+        seconds += elapsed.count();
+        samples.resize(profiler.zoneCount());
+        totals.resize(profiler.zoneCount());
+        for (int i = 0; i < profiler.zoneCount(); i++) {
+            samples[i].push_back(profiler.stats(i).last);
+            Profiler::CounterStats c = profiler.counters(i);
+            for (int k = 0; k < PerfCounters::COUNT; k++)
+                totals[i].values[k] += c.values[k];
+            totals[i].entities += c.entities;
+        }
+    }
+    counters = PerfCounters::get().enabled();
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    fprintf(out,
+            "{\"scenario\": \"%s\", \"ticks\": %d, \"seconds\": %.6f, "
+            "\"ticks_per_second\": %.1f, \"entities\": %zu, "
+            "\"peak_rss_kb\": %ld, \"perf_counters\": %s, \"systems\": {",
+            scenario.name, ticks, seconds, ticks / seconds,
+            game->entityCount(), usage.ru_maxrss, counters ? "true" : "false");
+    for (size_t i = 0; i < samples.size(); i++) {
+        fprintf(out, "%s\n    \"%s\": {\"p50_ms\": %.4f, \"p99_ms\": %.4f",
+                i ? "," : "", profiler.name(i).c_str(),
+                percentile(samples[i], 0.5), percentile(samples[i], 0.99));
+        const Profiler::CounterStats& c = totals[i];
+        if (counters && c.values[PerfCounters::CYCLES] > 0)
+            fprintf(out, ", \"ipc\": %.3f",
+                    (double)c.values[PerfCounters::INSTRUCTIONS] /
+                        c.values[PerfCounters::CYCLES]);
+        if (counters && c.entities > 0) {
+            for (int k : {PerfCounters::L1D_MISSES, PerfCounters::LLC_MISSES,
+                          PerfCounters::BRANCH_MISSES})
+                fprintf(out, ", \"%s_per_entity\": %.4f",
+                        PerfCounters::name(k),
+                        (double)c.values[k] / c.entities);
+        }
+        fprintf(out, "}");
+    }
+    fprintf(out, "}}");
+}
+
+// Runs the scenario in a child and returns its JSON, or an empty string if
+// it failed.
+static std::string forkScenario(const Scenario& scenario, int ticks,
+                                bool counters) {
+    int fds[2];
+    if (pipe(fds) != 0) return "";
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) return "";
+    if (pid == 0) {
+        close(fds[0]);
+        FILE* out = fdopen(fds[1], "w");
+        runScenario(scenario, ticks, counters, out);
+        fclose(out);
+        _exit(0);
+    }
+
+    close(fds[1]);
+    std::string json;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fds[0], buffer, sizeof(buffer))) > 0)
+        json.append(buffer, n);
+    close(fds[0]);
+
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return "";
+    return json;
+}
+
+static double ticksPerSecond(const std::string& json) {
+    const char* key = "\"ticks_per_second\": ";
+    size_t at = json.find(key);
+    return at == std::string::npos ? 0 : atof(json.c_str() + at + strlen(key));
+}
+
+// Prints a line per scenario to stderr and returns the number that regressed.
+static int compare(const Baseline& baseline, const Baseline& current,
+                   const std::vector<const Scenario*>& scenarios,
+                   double threshold) {
+    const double ALPHA = 0.05;
+    int regressions = 0;
+    fprintf(stderr, "%-18s %12s %12s %8s %18s %8s\n", "scenario", "baseline",
+            "current", "change", "95% CI", "p");
+    for (const Scenario* scenario : scenarios) {
+        const std::vector<double>* now = current.samples(scenario->name);
+        const std::vector<double>* then = baseline.samples(scenario->name);
+        if (!now) continue;
+        if (!then || then->empty()) {
+            fprintf(stderr, "%-18s %12s %12.1f  not in baseline\n",
+                    scenario->name, "-", median(*now));
+            continue;
+        }
+        double ratio = median(*now) / median(*then);
+        double low, high;
+        bootstrapRatio(*now, *then, 1, low, high);
+        double p = mannWhitneyLess(*now, *then);
+        bool regressed = p < ALPHA && ratio < 1 - threshold / 100;
+        regressions += regressed;
+        fprintf(stderr,
+                "%-18s %12.1f %12.1f %+7.1f%% [%+6.1f%%, %+6.1f%%] %8.4f%s\n",
+                scenario->name, median(*then), median(*now),
+                100 * (ratio - 1), 100 * (low - 1), 100 * (high - 1), p,
+                regressed ? "  REGRESSED" : "");
+    }
+    return regressions;
+}
+
+int main(int argc, char* argv[]) {
+    int ticks = 0, repeat = 1;
+    bool counters = false;
+    double threshold = 5;
+    std::string savePath, baselinePath;
+    std::vector<std::string> filter;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc)
+            ticks = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--perf-counters") == 0)
+            counters = true;
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+            repeat = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--save-baseline") == 0 && i + 1 < argc)
+            savePath = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+            baselinePath = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+            threshold = atof(argv[++i]);
+        else
+            filter.push_back(argv[i]);
+    }
+
+    Baseline baseline;
+    if (!baselinePath.empty() && !baseline.load(baselinePath)) {
+        fprintf(stderr, "could not read baseline %s\n", baselinePath.c_str());
+        return 1;
+    }
+
+    std::vector<const Scenario*> scenarios;
+    for (const Scenario& scenario : SCENARIOS) {
+        if (filter.empty() ||
+            std::find(filter.begin(), filter.end(), scenario.name) !=
+                filter.end())
+            scenarios.push_back(&scenario);
+    }
+
+    Baseline current;
+    int failed = 0;
+    bool first = true;
+    printf("[");
+    for (int run = 0; run < repeat; run++) {
+        for (const Scenario* scenario : scenarios) {
+            if (repeat > 1)
+                fprintf(stderr, "%s (%d/%d)...\n", scenario->name, run + 1,
+                        repeat);
+            else
+                fprintf(stderr, "%s...\n", scenario->name);
+            std::string json = forkScenario(
+                *scenario, ticks > 0 ? ticks : scenario->ticks, counters);
+            if (json.empty()) {
+                fprintf(stderr, "%s failed\n", scenario->name);
+                failed++;
+                continue;
+            }
+            current.add(scenario->name, ticksPerSecond(json));
+            printf("%s\n%s", first ? "" : ",", json.c_str());
+            first = false;
+        }
+    }
+    printf("\n]\n");
+    if (failed) return 1;
+
+    if (!savePath.empty() && !current.save(savePath)) {
+        fprintf(stderr, "could not write baseline %s\n", savePath.c_str());
+        return 1;
+    }
+    if (!baselinePath.empty() &&
+        compare(baseline, current, scenarios, threshold) > 0)
+        return 2;
+    return 0;
+}
@@ -7,11 +7,13 @@
 class CTransform {
    public:
     Vec2 pos = {0, 0};
+    Vec2 prevPos = {0, 0};
     Vec2 velocity = {0, 0};
     float angle = 0, friction = 0, speed = 0;
     CTransform(const Vec2 _pos, const Vec2 _velocity, float _angle,
                float _friction, float _speed)
         : pos(_pos),
+          prevPos(_pos),
           velocity(_velocity),
           angle(_angle),
           friction(_friction),
@@ -44,11 +46,13 @@ class CScore {
     CScore(int _score) : score(_score) {}
 };
 
+// expiry is the lifespan tick the entity dies on, set when the entity is
+// added. The lifespan clock stands still while the Lifespan system is off.
 class CLifespan {
    public:
     int total = 0;
-    int remaining = 0;
-    CLifespan(int _total) : total(_total), remaining(_total) {}
+    int expiry = 0;
+    CLifespan(int _total) : total(_total) {}
 };
 
 class CInput {
@@ -1,5 +1,7 @@
 #include "EntityManager.h"
 
+#include "Profiler.h"
+
 EntityManager::EntityManager() {}
 
 void EntityManager::removeDeadEntities(EntityVec& entities) {
@@ -12,15 +14,20 @@ void EntityManager::removeDeadEntities(EntityVec& entities) {
 }
 
 void EntityManager::update() {
-    for (auto& e : m_entities2add) {
+    PROFILE_ZONE_N("EntityManager::update", m_entities2add.size());
+    size_t before = m_entities.size();
+    bool added = !m_entities2add.empty();
+    m_added.swap(m_entities2add);
+    m_entities2add.clear();
+    for (auto& e : m_added) {
         m_entities.push_back(e);
         m_entityMap[e->tag()].push_back(e);
     }
-    m_entities2add.clear();
     removeDeadEntities(m_entities);
     for (auto& [tag, e] : m_entityMap) {
         removeDeadEntities(e);
     }
+    if (added || m_entities.size() != before) m_version++;
 }
 
 std::shared_ptr<Entity> EntityManager::addEntity(std::string tag) {
@@ -31,8 +38,41 @@ std::shared_ptr<Entity> EntityManager::addEntity(std::string tag) {
 
 const EntityVec& EntityManager::getEntities() { return m_entities; }
 
+// Lookups never insert, so systems running concurrently can query tags.
 const EntityVec& EntityManager::getEntities(const std::string& tag) {
-    return m_entityMap[tag];
+    static const EntityVec empty;
+    auto it = m_entityMap.find(tag);
+    return it == m_entityMap.end() ? empty : it->second;
 }
 
 const EntityMap& EntityManager::getEntityMap() { return m_entityMap; }
+
+const EntityVec& EntityManager::getPendingEntities() { return m_entities2add; }
+
+const EntityVec& EntityManager::getAddedEntities() { return m_added; }
+
+size_t EntityManager::getTotalEntities() const { return m_totalEntities; }
+
+size_t EntityManager::getVersion() const { return m_version; }
+
+void EntityManager::clear(size_t totalEntities) {
+    m_entities.clear();
+    m_entities2add.clear();
+    m_added.clear();
+    m_entityMap.clear();
+    m_totalEntities = totalEntities;
+    m_version++;
+}
+
+std::shared_ptr<Entity> EntityManager::restoreEntity(const std::string& tag,
+                                                     size_t id, bool pending) {
+    auto e = std::shared_ptr<Entity>(new Entity(tag, id));
+    if (pending) {
+        m_entities2add.push_back(e);
+    } else {
+        m_entities.push_back(e);
+        m_entityMap[tag].push_back(e);
+        m_version++;
+    }
+    return e;
+}
@@ -11,8 +11,10 @@ typedef std::map<std::string, EntityVec> EntityMap;
 class EntityManager {
     EntityVec m_entities;
     EntityVec m_entities2add;
+    EntityVec m_added;
     EntityMap m_entityMap;
     size_t m_totalEntities = 0;
+    size_t m_version = 0;
 
     void removeDeadEntities(EntityVec& entities);
 
@@ -26,4 +28,19 @@ class EntityManager {
     const EntityVec& getEntities();
     const EntityVec& getEntities(const std::string& tag);
     const EntityMap& getEntityMap();
+    const EntityVec& getPendingEntities();
+    // Entities the last update() added.
+    const EntityVec& getAddedEntities();
+    size_t getTotalEntities() const;
+
+    // Changes whenever entities are added or removed, so callers can cache
+    // queries over them.
+    size_t getVersion() const;
+
+    // Used to restore snapshots: clear() removes every entity and continues
+    // ids from totalEntities, restoreEntity() adds an entity with a given id,
+    // either live or pending until the next update().
+    void clear(size_t totalEntities);
+    std::shared_ptr<Entity> restoreEntity(const std::string& tag, size_t id,
+                                          bool pending);
 };
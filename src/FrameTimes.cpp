@@ -0,0 +1,89 @@
+#include "FrameTimes.h"
+
+#include <algorithm>
+#include <fstream>
+
+// A value with its highest bit at msb is shifted right until SUB_BITS + 1
+// bits are left, which lands the top half of the buckets of that shift.
+// Values below 2 * SUB_BUCKETS need no shift and map onto themselves.
+int TimeHistogram::bucket(int64_t value) {
+    if (value < 0) value = 0;
+    int msb = 63 - __builtin_clzll(value | 1);
+    int shift = std::max(0, msb - SUB_BITS);
+    if (shift > MAX_SHIFT) return BUCKETS - 1;
+    return (shift << SUB_BITS) + (int)(value >> shift);
+}
+
+int64_t TimeHistogram::value(int bucket) {
+    int shift = std::max(0, (bucket >> SUB_BITS) - 1);
+    int64_t sub = bucket - (shift << SUB_BITS);
+    return (sub << shift) + ((int64_t)1 << shift) / 2;
+}
+
+void TimeHistogram::record(int64_t microseconds) {
+    m_counts[bucket(microseconds)]++;
+    m_total++;
+    m_max = std::max(m_max, microseconds);
+}
+
+void TimeHistogram::clear() {
+    std::fill(m_counts, m_counts + BUCKETS, 0);
+    m_total = 0;
+    m_max = 0;
+}
+
+uint64_t TimeHistogram::count() const { return m_total; }
+
+int64_t TimeHistogram::max() const { return m_max; }
+
+int64_t TimeHistogram::percentile(double p) const {
+    if (m_total == 0) return 0;
+    uint64_t rank = std::max<uint64_t>(1, p * m_total + 0.5);
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += m_counts[i];
+        if (seen >= rank) return std::min(value(i), m_max);
+    }
+    return m_max;
+}
+
+FrameTimes::FrameTimes() {}
+
+const char* FrameTimes::name(int series) {
+    static const char* names[COUNT] = {"frame", "sim", "render"};
+    return names[series];
+}
+
+void FrameTimes::setTarget(int64_t microseconds) { m_target = microseconds; }
+
+void FrameTimes::record(Series series, int64_t microseconds) {
+    m_series[series].record(microseconds);
+    if (series == FRAME && m_target > 0 && microseconds * 2 > m_target * 3)
+        m_missedVsync++;
+}
+
+void FrameTimes::clear() {
+    for (auto& h : m_series) h.clear();
+    m_missedVsync = 0;
+}
+
+const TimeHistogram& FrameTimes::histogram(int series) const {
+    return m_series[series];
+}
+
+uint64_t FrameTimes::missedVsync() const { return m_missedVsync; }
+
+bool FrameTimes::writeCsv(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "series,count,p50_ms,p95_ms,p99_ms,p999_ms,max_ms,missed_vsync\n";
+    for (int i = 0; i < COUNT; i++) {
+        const TimeHistogram& h = m_series[i];
+        out << name(i) << ',' << h.count();
+        for (double p : {0.5, 0.95, 0.99, 0.999})
+            out << ',' << h.percentile(p) / 1000.0;
+        out << ',' << h.max() / 1000.0 << ','
+            << (i == FRAME ? m_missedVsync : 0) << '\n';
+    }
+    return (bool)out;
+}
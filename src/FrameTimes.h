@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Histogram of durations in microseconds with log-linear buckets, in the
+// style of HdrHistogram. Values below 128 us have a bucket each; above that
+// every power of two is split into 64 buckets, so a bucket is never wider
+// than 1/64 of the values in it. Recording is O(1) and the size is fixed.
+class TimeHistogram {
+    static const int SUB_BITS = 6;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int MAX_SHIFT = 26;  // up to about 2^33 us, 2.4 hours
+    static const int BUCKETS = (MAX_SHIFT + 2) * SUB_BUCKETS;
+
+    uint64_t m_counts[BUCKETS] = {};
+    uint64_t m_total = 0;
+    int64_t m_max = 0;
+
+    static int bucket(int64_t value);
+    // The middle of the range of values that fall into a bucket.
+    static int64_t value(int bucket);
+
+   public:
+    void record(int64_t microseconds);
+    void clear();
+
+    uint64_t count() const;
+    int64_t max() const;
+    // The value below which the fraction p of the recorded values fall,
+    // within the bucket precision. 0 when empty.
+    int64_t percentile(double p) const;
+};
+
+// Frame, simulation and render times of the windowed game, plus how many
+// frames missed vsync. A frame counts as missed when it takes more than
+// 1.5 times the target frame time, which is where a frame that waited for
+// the next vertical blank ends up.
+class FrameTimes {
+   public:
+    enum Series { FRAME, SIM, RENDER, COUNT };
+
+   private:
+    TimeHistogram m_series[COUNT];
+    int64_t m_target = 0;
+    uint64_t m_missedVsync = 0;
+
+   public:
+    FrameTimes();
+
+    static const char* name(int series);
+
+    // The frame time the game aims for, 0 when the frame rate is unlimited.
+    void setTarget(int64_t microseconds);
+    void record(Series series, int64_t microseconds);
+    void clear();
+
+    const TimeHistogram& histogram(int series) const;
+    uint64_t missedVsync() const;
+
+    // One row per series with its count, p50, p95, p99, p99.9 and max in
+    // milliseconds, and the missed vsync count.
+    bool writeCsv(const std::string& path) const;
+};
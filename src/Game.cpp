@@ -1,17 +1,23 @@
 #include "Game.h"
 
+#include "Profiler.h"
+#include "SamplingProfiler.h"
+
 #include <algorithm>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
-#include <random>
 
-Game::Game(const std::string config) {
-    if (!init(config)) exit(-1);
+Game::Game(const GameOptions& options) : m_options(options) {
+    if (!init(m_options.config)) exit(-1);
 }
 
 bool Game::init(const std::string path) {
-    srand(time(NULL));
     std::ifstream fin(path);
+    if (!fin) {
+        std::cerr << "Failed to open " << path << " :(\n";
+        return false;
+    }
     std::string type;
 
     while (fin >> type) {
@@ -41,24 +47,64 @@ bool Game::init(const std::string path) {
                 m_bulletConfig.FR >> m_bulletConfig.FG >> m_bulletConfig.FB >>
                 m_bulletConfig.OR >> m_bulletConfig.OG >> m_bulletConfig.OB >>
                 m_bulletConfig.OT >> m_bulletConfig.V >> m_bulletConfig.L;
-    }
 
-    if (m_windowConfig.fullscreen)
-        m_window.create(sf::VideoMode(m_windowConfig.W, m_windowConfig.H),
-                        "ECS Geometry War", sf::Style::Fullscreen);
-    else
-        m_window.create(sf::VideoMode(m_windowConfig.W, m_windowConfig.H),
-                        "ECS Geometry War", sf::Style::Default);
+        else if (type == "Particles")
+            fin >> m_particleConfig.N;
 
-    m_window.setFramerateLimit(m_windowConfig.FPS);
-    ImGui::SFML::Init(m_window);
-    ImGui::GetStyle().ScaleAllSizes(1.0f);
+        else if (type == "LOD")
+            fin >> m_lodConfig.SZ >> m_lodConfig.N >> m_lodConfig.V;
 
-    if (!m_font.loadFromFile(m_fontConfig.path)) {
-        std::cerr << "Failed to load font :(\n";
-        return false;
+        else if (type == "Simulation")
+            fin >> m_simulationConfig.RATE >> m_simulationConfig.MAX;
+
+        else if (type == "Jobs")
+            fin >> m_jobsConfig.N;
     }
 
+    m_particles = ParticleSystem(m_particleConfig.N);
+
+    if (!m_options.replay.empty()) {
+        if (!m_recording.load(m_options.replay)) {
+            std::cerr << "Failed to load " << m_options.replay << " :(\n";
+            return false;
+        }
+        m_options.seed = m_recording.seed();
+        m_replayingInput = true;
+    } else if (!m_options.record.empty()) {
+        m_recording.clear(m_options.seed);
+        m_recordingInput = true;
+    }
+
+    m_soakTicks = m_options.soak;
+    m_random.seed(m_options.seed);
+    m_spawnerRandom = m_random.stream("spawner");
+
+    size_t threads = m_jobsConfig.N > 0 ? m_jobsConfig.N
+                                        : std::thread::hardware_concurrency();
+    m_jobs = std::make_unique<JobSystem>(threads);
+
+    m_scheduler.add(
+        "Collision", Access::Transform | Access::Shape | Access::Collision,
+        Access::Transform | Access::Score | Access::Entities |
+            Access::Particles,
+        [this] { sCollision(); }, &m_collisionSystem);
+    m_scheduler.add(
+        "Spawning", 0, Access::Entities,
+        [this] {
+            if (!m_paused) sEnemySpawner();
+        },
+        &m_enemySpawnerSystem);
+    m_scheduler.add("Movement", Access::Input,
+                    Access::Transform | Access::Shape | Access::Collision,
+                    [this] { sMovement(); }, &m_movementSystem);
+    m_scheduler.add("Lifespan", 0, Access::Lifespan | Access::Entities,
+                    [this] { sLifespan(); }, &m_lifespanSystem);
+    m_scheduler.add("Particles", 0, Access::Particles,
+                    [this] { sParticles(); }, &m_particleSystem);
+    m_scheduler.build();
+
+    if (!m_options.headless && !initWindow()) return false;
+
     auto e = m_manager.addEntity("player");
 
     e->cShape = std::make_shared<CShape>(
@@ -77,46 +123,264 @@ bool Game::init(const std::string path) {
     return true;
 }
 
-void Game::run() {
-    while (m_window.isOpen()) {
-        m_manager.update();
-        ImGui::SFML::Update(m_window, m_deltaClock.restart());
-        if (m_currentFrame > 0) sGUI();
-        if (m_currentFrame > 0) sUserInput();
-        if (m_currentFrame > 0 && m_collisionSystem) sCollision();
-        if (m_currentFrame > 0 && m_enemySpawnerSystem && !m_paused)
-            sEnemySpawner();
-        if (m_currentFrame > 0 && m_movementSystem) sMovement();
-        if (m_currentFrame > 0 && m_lifespanSystem) sLifespan();
-        if (m_currentFrame > 0) sScore();
-        sRender();
-        if (m_currentFrame == 0) sPlayerSpawner();
+// The window, ImGui, the font and the HUD all need a GL context, so none of
+// them are created in headless mode.
+bool Game::initWindow() {
+    m_window = std::make_unique<sf::RenderWindow>();
+    if (m_windowConfig.fullscreen)
+        m_window->create(sf::VideoMode(m_windowConfig.W, m_windowConfig.H),
+                         "ECS Geometry War", sf::Style::Fullscreen);
+    else
+        m_window->create(sf::VideoMode(m_windowConfig.W, m_windowConfig.H),
+                         "ECS Geometry War", sf::Style::Default);
+
+    m_window->setFramerateLimit(m_windowConfig.FPS);
+    m_frameTimes.setTarget(m_windowConfig.FPS > 0 ? 1000000 / m_windowConfig.FPS
+                                                  : 0);
+    ImGui::SFML::Init(*m_window);
+    ImGui::GetStyle().ScaleAllSizes(1.0f);
+
+    if (!m_font.loadFromFile(m_fontConfig.path)) {
+        std::cerr << "Failed to load font :(\n";
+        return false;
+    }
+
+    m_hud = std::make_unique<Hud>();
+    if (!m_hud->init(m_font, m_fontConfig.SZ,
+                     sf::Color(m_fontConfig.R, m_fontConfig.G, m_fontConfig.B),
+                     "Score ")) {
+        std::cerr << "Failed to create HUD :(\n";
+        return false;
+    }
+    m_hud->setPosition(1, 1);
+    return true;
+}
+
+// Returns false if a replay did not end in the recorded state.
+bool Game::run() {
+    if (!m_options.sample.empty() &&
+        !SamplingProfiler::get().start(m_options.sampleHz))
+        std::cerr << "Failed to start the sampling profiler: "
+                  << SamplingProfiler::get().error() << "\n";
+    start();
+    if (!m_options.loadSnapshot.empty() &&
+        !loadSnapshot(m_options.loadSnapshot))
+        return false;
+
+    if (m_options.headless)
+        runHeadless();
+    else
+        runWindowed();
+
+    if (!m_options.saveSnapshot.empty() &&
+        !saveSnapshot(m_options.saveSnapshot))
+        return false;
+    if (!m_options.trace.empty()) writeTrace();
+    if (!m_options.sample.empty()) writeSamples();
+    if (!m_options.frameTimes.empty() &&
+        !m_frameTimes.writeCsv(m_options.frameTimes))
+        std::cerr << "Failed to write " << m_options.frameTimes << " :(\n";
+    return finishInput();
+}
+
+void Game::start() {
+    Profiler::get().setThreadName("main");
+    if (m_options.perfCounters && !PerfCounters::get().enable())
+        std::cerr << PerfCounters::get().error() << ", running without "
+                  << "hardware counters\n";
+    m_manager.update();
+    sPlayerSpawner();
+}
+
+// Gameplay advances in fixed ticks of 1/RATE seconds, independent of the
+// frame rate. Rendering interpolates between the last two ticks. At most MAX
+// ticks are run per frame; beyond that the game slows down rather than
+// spiralling into ever longer frames.
+void Game::runWindowed() {
+    sf::Time tick = sf::seconds(1.0f / m_simulationConfig.RATE);
+    sf::Time maxLag = tick * (float)m_simulationConfig.MAX;
+
+    while (m_window->isOpen()) {
+        Profiler::get().endFrame();
+        PROFILE_ZONE_N("Frame", m_manager.getEntities().size());
+
+        sf::Time dt = m_deltaClock.restart();
+        // The first frame's time includes loading.
+        if (m_currentFrame > 0)
+            m_frameTimes.record(FrameTimes::FRAME, dt.asMicroseconds());
+        {
+            PROFILE_ZONE("ImGui::SFML::Update");
+            ImGui::SFML::Update(*m_window, dt);
+        }
+        sGUI();
+        sUserInput();
+
+        m_accumulator += dt;
+        if (m_accumulator > maxLag) m_accumulator = maxLag;
+
+        // Soak mode runs a fixed number of ticks per frame, as fast as the
+        // machine allows, and drops real time.
+        m_ticksLastFrame = 0;
+        sf::Clock simClock;
+        if (m_soakTicks > 0) {
+            m_accumulator = sf::Time::Zero;
+            while (m_ticksLastFrame < m_soakTicks && !replayFinished()) {
+                step();
+                m_ticksLastFrame++;
+            }
+        }
+        while (m_accumulator >= tick && !replayFinished()) {
+            step();
+            m_accumulator -= tick;
+            m_ticksLastFrame++;
+        }
+        if (m_ticksLastFrame > 0)
+            m_frameTimes.record(FrameTimes::SIM,
+                                simClock.getElapsedTime().asMicroseconds());
+        sThroughput();
+        sMemory();
+
+        sScore();
+        sRender(m_soakTicks > 0
+                    ? 1.0f
+                    : m_accumulator.asSeconds() / tick.asSeconds());
         m_currentFrame++;
+        if (m_currentFrame == m_options.frames || replayFinished())
+            m_window->close();
     }
 }
 
-int randomNumber(int a, int b) { return a + std::rand() % (b - a + 1); }
+// Runs the requested number of ticks back to back, as fast as possible. A
+// replay without --frames runs to the end of the recording.
+void Game::runHeadless() {
+    sf::Clock clock;
+    int ticks = 0;
+    uint64_t entityTicks = m_entityTicks;
+    for (; m_options.frames <= 0 || ticks < m_options.frames; ticks++) {
+        if (replayFinished()) break;
+        sf::Clock simClock;
+        step();
+        m_frameTimes.record(FrameTimes::SIM,
+                            simClock.getElapsedTime().asMicroseconds());
+        if (m_options.memoryReport) sMemory();
+        Profiler::get().endFrame();
+    }
+    float seconds = clock.getElapsedTime().asSeconds();
+    entityTicks = m_entityTicks - entityTicks;
+
+    std::cout << "seed " << m_options.seed << ": " << ticks << " ticks in "
+              << seconds << " s (" << (uint64_t)(ticks / seconds)
+              << " ticks/s, " << (uint64_t)(entityTicks / seconds)
+              << " entities/s), "
+              << m_manager.getEntities().size() << " entities\n";
+#if ALLOC_TRACKING
+    printAllocations();
+#endif
+    if (m_options.memoryReport) {
+        m_memory.sample(m_manager, m_particles);
+        m_memory.report(std::cout);
+    }
+}
 
-void Game::sEnemySpawner() {
-    if (m_currentFrame % m_enemyConfig.R != 0) return;
-    int screenWidth = m_window.getView().getSize().x;
-    int screenHeight = m_window.getView().getSize().y;
+// Allocations per tick of every zone that allocated, most first. A zone only
+// counts what it allocated outside its nested zones.
+void Game::printAllocations() {
+    Profiler& profiler = Profiler::get();
+    std::vector<std::pair<Profiler::AllocationStats, std::string>> zones;
+    zones.push_back({profiler.allocations(-1), "(outside zones)"});
+    for (int i = 0; i < profiler.zoneCount(); i++)
+        zones.push_back({profiler.allocations(i), profiler.name(i)});
+    std::sort(zones.begin(), zones.end(), [](const auto& a, const auto& b) {
+        return a.first.avgCount > b.first.avgCount;
+    });
+
+    double count = 0, bytes = 0;
+    for (auto& [a, name] : zones) {
+        count += a.avgCount;
+        bytes += a.avgBytes;
+    }
+    std::cout << std::fixed << std::setprecision(1) << "allocations per tick: "
+              << count << " (" << bytes << " bytes)\n";
+    for (auto& [a, name] : zones) {
+        if (a.avgCount == 0) break;
+        std::cout << "  " << std::left << std::setw(24) << name << std::right
+                  << std::setw(10) << a.avgCount << std::setw(12)
+                  << a.avgBytes << " bytes\n";
+    }
+    std::cout << std::defaultfloat;
+}
+
+// Ticks and entity updates per second, averaged over about a second.
+void Game::sThroughput() {
+    float seconds = m_throughputClock.getElapsedTime().asSeconds();
+    if (seconds < 1) return;
+    m_ticksPerSecond = (m_currentTick - m_throughputTick) / seconds;
+    m_entitiesPerSecond = (m_entityTicks - m_throughputEntityTicks) / seconds;
+    m_throughputTick = m_currentTick;
+    m_throughputEntityTicks = m_entityTicks;
+    m_throughputClock.restart();
+}
+
+// Samples the storage sizes once per second of game time, which is enough
+// for the peaks, and every frame while the Memory tab shows them. Counting
+// ticks keeps the rate independent of the frame rate and of soak mode; a
+// snapshot load that moves the tick back samples right away.
+void Game::sMemory() {
+    PROFILE_ZONE("sMemory");
+    int elapsed = m_currentTick - m_memoryTick;
+    if (!m_memoryTab && elapsed >= 0 && elapsed < m_simulationConfig.RATE)
+        return;
+    m_memoryTick = m_currentTick;
+    m_memory.sample(m_manager, m_particles);
+}
 
-    float speed = randomNumber(m_enemyConfig.S_MIN, m_enemyConfig.S_MAX);
+void Game::step() {
+    PROFILE_ZONE_N("Step", m_manager.getEntities().size());
+    m_currentTick++;
+    if (m_lifespanSystem) m_lifespanTick++;
+    sInput();
+    m_manager.update();
+    m_entityTicks += m_manager.getEntities().size();
+    for (auto& e : m_manager.getAddedEntities()) {
+        if (!e->cLifespan) continue;
+        e->cLifespan->expiry = m_lifespanTick + e->cLifespan->total;
+        m_lifespans.schedule(e, e->cLifespan->expiry);
+    }
+    for (auto& e : m_manager.getEntities())
+        if (e->cTransform) e->cTransform->prevPos = e->cTransform->pos;
 
-    Vec2 pos(
-        randomNumber(m_enemyConfig.CR + 1, screenWidth - m_enemyConfig.CR - 1),
-        randomNumber(m_enemyConfig.CR + 1,
-                     screenHeight - m_enemyConfig.CR - 1));
+    m_scheduler.run(*m_jobs);
+}
 
-    int vertices = randomNumber(m_enemyConfig.V_MIN, m_enemyConfig.V_MAX);
+void Game::sEnemySpawner() {
+    PROFILE_ZONE("sEnemySpawner");
+    if (m_currentTick % m_enemyConfig.R != 0) return;
+    spawnEnemy();
+}
 
-    Vec2 dir(randomNumber(-screenWidth, screenWidth),
-             randomNumber(-screenHeight, screenHeight));
+void Game::spawnEnemy() {
+    int screenWidth = m_windowConfig.W;
+    int screenHeight = m_windowConfig.H;
+    int border = m_enemyConfig.CR + 1;
+
+    enum { SPEED, X, Y, VERTICES, DIR_X, DIR_Y, RED, GREEN, BLUE, COUNT };
+    const int lo[COUNT] = {m_enemyConfig.S_MIN, border, border,
+                           m_enemyConfig.V_MIN, -screenWidth, -screenHeight,
+                           0, 0, 0};
+    const int hi[COUNT] = {m_enemyConfig.S_MAX, screenWidth - border,
+                           screenHeight - border, m_enemyConfig.V_MAX,
+                           screenWidth, screenHeight, 255, 255, 255};
+    int value[COUNT];
+    m_spawnerRandom.range(value, lo, hi, COUNT);
+
+    float speed = value[SPEED];
+    Vec2 pos(value[X], value[Y]);
+    int vertices = value[VERTICES];
+
+    Vec2 dir(value[DIR_X], value[DIR_Y]);
     dir = dir.normalize();
 
-    sf::Color fill(randomNumber(0, 255), randomNumber(0, 255),
-                   randomNumber(0, 255));
+    sf::Color fill(value[RED], value[GREEN], value[BLUE]);
 
     auto e = m_manager.addEntity("enemy");
 
@@ -128,87 +392,479 @@ void Game::sEnemySpawner() {
     e->cCollision = std::make_shared<CCollision>(m_enemyConfig.CR);
 }
 
+static uint8_t keyFlag(sf::Keyboard::Key key) {
+    switch (key) {
+        case sf::Keyboard::W:
+            return TickInput::UP;
+        case sf::Keyboard::S:
+            return TickInput::DOWN;
+        case sf::Keyboard::A:
+            return TickInput::LEFT;
+        case sf::Keyboard::D:
+            return TickInput::RIGHT;
+        case sf::Keyboard::P:
+            return TickInput::PAUSE;
+        default:
+            return 0;
+    }
+}
+
+static uint8_t buttonFlag(sf::Mouse::Button button) {
+    switch (button) {
+        case sf::Mouse::Left:
+            return TickInput::SHOOT;
+        case sf::Mouse::Right:
+            return TickInput::SPECIAL;
+        default:
+            return 0;
+    }
+}
+
+// Collects live input once per frame. It takes effect in sInput at the next
+// tick; presses are latched until then, so frames without a tick don't lose
+// them.
 void Game::sUserInput() {
-    if (!m_window.hasFocus()) return;
+    PROFILE_ZONE("sUserInput");
+    if (!m_window->hasFocus()) return;
     sf::Event event;
-    while (m_window.pollEvent(event)) {
-        ImGui::SFML::ProcessEvent(m_window, event);
+    while (m_window->pollEvent(event)) {
+        ImGui::SFML::ProcessEvent(*m_window, event);
         if (event.type == sf::Event::Closed)
-            m_window.close();
+            m_window->close();
         else if (event.type == sf::Event::KeyPressed) {
-            if (event.key.code == sf::Keyboard::Escape) m_window.close();
-            if (event.key.code == sf::Keyboard::W) {
-                for (auto& e : m_manager.getEntities())
-                    if (e->cInput) e->cInput->up = true;
-            }
-            if (event.key.code == sf::Keyboard::S) {
-                for (auto& e : m_manager.getEntities())
-                    if (e->cInput) e->cInput->down = true;
+            if (event.key.code == sf::Keyboard::Escape) m_window->close();
+            if (event.key.code == sf::Keyboard::F5) saveSnapshot(m_quickSave);
+            if (event.key.code == sf::Keyboard::F9 && m_quickSave.size())
+                loadSnapshot(m_quickSave);
+            if (event.key.code == sf::Keyboard::F8) writeTrace();
+            uint8_t key = keyFlag(event.key.code);
+            m_liveInput.pressed |= key & ~m_liveInput.held;
+            m_liveInput.held |= key;
+        } else if (event.type == sf::Event::KeyReleased) {
+            m_liveInput.held &= ~keyFlag(event.key.code);
+        } else if (event.type == sf::Event::MouseButtonPressed) {
+            // A click can end before the buttons are polled below; keep
+            // where it happened for the tick that fires it.
+            uint8_t button = buttonFlag(event.mouseButton.button);
+            m_liveInput.pressed |= button & ~m_liveInput.held;
+            if (button) {
+                m_liveInput.mouseX = event.mouseButton.x;
+                m_liveInput.mouseY = event.mouseButton.y;
             }
-            if (event.key.code == sf::Keyboard::A) {
-                for (auto& e : m_manager.getEntities())
-                    if (e->cInput) e->cInput->left = true;
+        }
+    }
+
+    uint8_t buttons = 0;
+    if (sf::Mouse::isButtonPressed(sf::Mouse::Left))
+        buttons |= TickInput::SHOOT;
+    if (sf::Mouse::isButtonPressed(sf::Mouse::Right))
+        buttons |= TickInput::SPECIAL;
+    uint8_t mask = TickInput::SHOOT | TickInput::SPECIAL;
+    m_liveInput.pressed |= buttons & ~m_liveInput.held;
+    m_liveInput.held = (m_liveInput.held & ~mask) | buttons;
+
+    if (buttons) {
+        sf::Vector2i mouse = sf::Mouse::getPosition(*m_window);
+        m_liveInput.mouseX = mouse.x;
+        m_liveInput.mouseY = mouse.y;
+    } else if (!(m_liveInput.pressed & mask)) {
+        m_liveInput.mouseX = 0;
+        m_liveInput.mouseY = 0;
+    }
+}
+
+// Takes this tick's input from the replay or the live state, records it
+// and applies it.
+void Game::sInput() {
+    PROFILE_ZONE("sInput");
+    m_tickInput = m_replayingInput ? m_recording[m_replayTick++] : m_liveInput;
+    m_liveInput.pressed = 0;
+    if (m_recordingInput) m_recording.add(m_tickInput);
+
+    const TickInput& input = m_tickInput;
+    if (input.pressed & TickInput::PAUSE) m_paused = !m_paused;
+    for (auto& e : inputOwners()) {
+        e->cInput->up = input.held & TickInput::UP;
+        e->cInput->down = input.held & TickInput::DOWN;
+        e->cInput->left = input.held & TickInput::LEFT;
+        e->cInput->right = input.held & TickInput::RIGHT;
+        e->cInput->shoot = input.held & TickInput::SHOOT;
+    }
+    processInput();
+
+    if (m_paused) return;
+    Vec2 mouse(input.mouseX, input.mouseY);
+    uint8_t triggers = input.held | input.pressed;
+    if (triggers & TickInput::SHOOT) spawnWeapon(mouse);
+    if (triggers & TickInput::SPECIAL) spawnSpecialWeapon(mouse);
+}
+
+// Entities with an input component, recomputed only when the set of
+// entities changed.
+const EntityVec& Game::inputOwners() {
+    if (m_inputOwnersVersion != m_manager.getVersion()) {
+        m_inputOwners.clear();
+        for (auto& e : m_manager.getEntities())
+            if (e->cInput) m_inputOwners.push_back(e);
+        m_inputOwnersVersion = m_manager.getVersion();
+    }
+    return m_inputOwners;
+}
+
+bool Game::replayFinished() const {
+    return m_replayingInput && m_replayTick == m_recording.size();
+}
+
+// Saves the recording, or compares the final world with the recorded one.
+bool Game::finishInput() {
+    uint64_t hash = worldHash();
+    if (m_recordingInput) {
+        m_recording.setHash(hash);
+        if (!m_recording.save(m_options.record)) {
+            std::cerr << "Failed to save " << m_options.record << " :(\n";
+            return false;
+        }
+        std::cout << "Recorded " << m_recording.size() << " ticks to "
+                  << m_options.record << ", hash " << std::hex << hash
+                  << std::dec << "\n";
+    }
+    if (m_replayingInput) {
+        if (!replayFinished()) {
+            std::cout << "Replay stopped after " << m_replayTick << " of "
+                      << m_recording.size() << " ticks\n";
+            return true;
+        }
+        bool match = hash == m_recording.hash();
+        std::cout << "Replay of " << m_recording.size() << " ticks "
+                  << (match ? "matches" : "DIFFERS") << ": hash " << std::hex
+                  << hash << ", recorded " << m_recording.hash() << std::dec
+                  << "\n";
+        return match;
+    }
+    return true;
+}
+
+// FNV-1a over the simulation state a replay has to reproduce. Floats are
+// hashed bit for bit.
+uint64_t Game::worldHash() {
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    };
+
+    add(&m_currentTick, sizeof(m_currentTick));
+    add(&m_lifespanTick, sizeof(m_lifespanTick));
+    add(&m_paused, sizeof(m_paused));
+    for (auto& e : m_manager.getEntities()) {
+        add(&e->id(), sizeof(size_t));
+        add(e->tag().data(), e->tag().size());
+        if (e->cTransform) {
+            const CTransform& t = *e->cTransform;
+            float values[] = {t.pos.x, t.pos.y, t.velocity.x, t.velocity.y,
+                              t.angle, t.speed};
+            add(values, sizeof(values));
+        }
+        if (e->cCollision)
+            add(&e->cCollision->radius, sizeof(e->cCollision->radius));
+        if (e->cLifespan)
+            add(&e->cLifespan->expiry, sizeof(e->cLifespan->expiry));
+        if (e->cScore) add(&e->cScore->score, sizeof(e->cScore->score));
+    }
+    size_t particles = m_particles.size();
+    add(&particles, sizeof(particles));
+    return hash;
+}
+
+// Snapshots gather each component type into one array of plain records and
+// copy the arrays in bulk. Entities are stored in order, live ones first,
+// with a mask of the components they have.
+namespace {
+const uint32_t SNAPSHOT_MAGIC = 0x53574753;  // "SGWS"
+const uint32_t SNAPSHOT_VERSION = 3;
+
+enum : uint8_t {
+    HAS_TRANSFORM = 1 << 0,
+    HAS_SHAPE = 1 << 1,
+    HAS_COLLISION = 1 << 2,
+    HAS_SCORE = 1 << 3,
+    HAS_LIFESPAN = 1 << 4,
+    HAS_INPUT = 1 << 5,
+};
+
+struct EntityRecord {
+    uint64_t id;
+    uint16_t tag;
+    uint8_t components;
+    uint8_t pending;
+};
+struct TransformRecord {
+    float x, y, prevX, prevY, vx, vy, angle, friction, speed;
+};
+struct ShapeRecord {
+    float radius, thickness;
+    uint32_t points;
+    sf::Color fill, outline;
+};
+struct LifespanRecord {
+    int total, expiry;
+};
+struct InputRecord {
+    bool up, down, left, right, shoot;
+};
+
+struct SnapshotArrays {
+    std::vector<EntityRecord> entities;
+    std::vector<TransformRecord> transforms;
+    std::vector<ShapeRecord> shapes;
+    std::vector<float> collisions;
+    std::vector<int> scores;
+    std::vector<LifespanRecord> lifespans;
+    std::vector<InputRecord> inputs;
+};
+}  // namespace
+
+void Game::saveSnapshot(Snapshot& snapshot) {
+    sf::Clock clock;
+    std::vector<std::string> tags;
+    SnapshotArrays a;
+    size_t n = m_manager.getEntities().size() +
+               m_manager.getPendingEntities().size();
+    a.entities.reserve(n);
+    a.transforms.reserve(n);
+    a.shapes.reserve(n);
+    a.collisions.reserve(n);
+    a.lifespans.reserve(n);
+
+    auto gather = [&](const EntityVec& entities, bool pending) {
+        for (auto& e : entities) {
+            if (!e->isAlive()) continue;
+            auto tag = std::find(tags.begin(), tags.end(), e->tag());
+            if (tag == tags.end()) tag = tags.insert(tags.end(), e->tag());
+
+            EntityRecord r = {e->id(), (uint16_t)(tag - tags.begin()), 0,
+                              pending};
+            if (auto& t = e->cTransform) {
+                r.components |= HAS_TRANSFORM;
+                a.transforms.push_back({t->pos.x, t->pos.y, t->prevPos.x,
+                                        t->prevPos.y, t->velocity.x,
+                                        t->velocity.y, t->angle, t->friction,
+                                        t->speed});
             }
-            if (event.key.code == sf::Keyboard::D) {
-                for (auto& e : m_manager.getEntities())
-                    if (e->cInput) e->cInput->right = true;
+            if (e->cShape) {
+                const sf::CircleShape& shape = e->cShape->shape;
+                r.components |= HAS_SHAPE;
+                a.shapes.push_back(
+                    {shape.getRadius(), shape.getOutlineThickness(),
+                     (uint32_t)shape.getPointCount(), shape.getFillColor(),
+                     shape.getOutlineColor()});
             }
-        } else if (event.type == sf::Event::KeyReleased) {
-            if (event.key.code == sf::Keyboard::W) {
-                for (auto& e : m_manager.getEntities())
-                    if (e->cInput) e->cInput->up = false;
+            if (e->cCollision) {
+                r.components |= HAS_COLLISION;
+                a.collisions.push_back(e->cCollision->radius);
             }
-            if (event.key.code == sf::Keyboard::S) {
-                for (auto& e : m_manager.getEntities())
-                    if (e->cInput) e->cInput->down = false;
+            if (e->cScore) {
+                r.components |= HAS_SCORE;
+                a.scores.push_back(e->cScore->score);
             }
-            if (event.key.code == sf::Keyboard::A) {
-                for (auto& e : m_manager.getEntities())
-                    if (e->cInput) e->cInput->left = false;
+            if (e->cLifespan) {
+                r.components |= HAS_LIFESPAN;
+                a.lifespans.push_back(
+                    {e->cLifespan->total, e->cLifespan->expiry});
             }
-            if (event.key.code == sf::Keyboard::D) {
-                for (auto& e : m_manager.getEntities())
-                    if (e->cInput) e->cInput->right = false;
+            if (auto& i = e->cInput) {
+                r.components |= HAS_INPUT;
+                a.inputs.push_back({i->up, i->down, i->left, i->right,
+                                    i->shoot});
             }
-            if (event.key.code == sf::Keyboard::P) m_paused = !m_paused;
+            a.entities.push_back(r);
         }
-        if (sf::Mouse::isButtonPressed(sf::Mouse::Left) && !m_paused)
-            spawnWeapon();
-        if (sf::Mouse::isButtonPressed(sf::Mouse::Right) && !m_paused)
-            spawnSpecialWeapon();
-    }
-    processInput();
+    };
+    gather(m_manager.getEntities(), false);
+    gather(m_manager.getPendingEntities(), true);
+
+    snapshot.clear();
+    snapshot.write(SNAPSHOT_MAGIC);
+    snapshot.write(SNAPSHOT_VERSION);
+    snapshot.write(m_currentTick);
+    snapshot.write(m_lifespanTick);
+    snapshot.write(m_currentFrame);
+    snapshot.write(m_paused);
+    snapshot.write(m_score);
+    snapshot.write(m_lastNormalShoot);
+    snapshot.write(m_lastSpecialShoot);
+    snapshot.write(m_input);
+    snapshot.write(m_spawnerRandom);
+    snapshot.write((uint64_t)m_manager.getTotalEntities());
+
+    snapshot.write((uint64_t)tags.size());
+    for (auto& tag : tags) snapshot.write(tag);
+    snapshot.write(a.entities);
+    snapshot.write(a.transforms);
+    snapshot.write(a.shapes);
+    snapshot.write(a.collisions);
+    snapshot.write(a.scores);
+    snapshot.write(a.lifespans);
+    snapshot.write(a.inputs);
+    m_particles.save(snapshot);
+
+    m_snapshotMicroseconds = clock.getElapsedTime().asMicroseconds();
 }
 
-void Game::processInput() {
-    for (auto& e : m_manager.getEntities()) {
-        if (e->cInput && e->cTransform) {
-            if (e->cInput->up)
-                m_input.y = -1;
-            else if (e->cInput->down)
-                m_input.y = 1;
-            else
-                m_input.y = 0;
+// Everything is read and checked before the world is touched, so a bad
+// snapshot leaves the game as it was.
+bool Game::loadSnapshot(Snapshot& snapshot) {
+    sf::Clock clock;
+    snapshot.rewind();
+
+    uint32_t magic, version;
+    int tick, lifespanTick, frame, score, lastNormalShoot, lastSpecialShoot;
+    bool paused;
+    Vec2 input(0, 0);
+    RandomStream random;
+    uint64_t totalEntities, tagCount;
+    std::vector<std::string> tags;
+    SnapshotArrays a;
+    ParticleSystem particles;
+
+    if (!snapshot.read(magic) || magic != SNAPSHOT_MAGIC ||
+        !snapshot.read(version) || version != SNAPSHOT_VERSION ||
+        !snapshot.read(tick) || !snapshot.read(lifespanTick) ||
+        !snapshot.read(frame) ||
+        !snapshot.read(paused) || !snapshot.read(score) ||
+        !snapshot.read(lastNormalShoot) || !snapshot.read(lastSpecialShoot) ||
+        !snapshot.read(input) || !snapshot.read(random) ||
+        !snapshot.read(totalEntities) || !snapshot.read(tagCount))
+        return false;
+    for (uint64_t i = 0; i < tagCount; i++) {
+        std::string tag;
+        if (!snapshot.read(tag)) return false;
+        tags.push_back(tag);
+    }
+    if (!snapshot.read(a.entities) || !snapshot.read(a.transforms) ||
+        !snapshot.read(a.shapes) || !snapshot.read(a.collisions) ||
+        !snapshot.read(a.scores) || !snapshot.read(a.lifespans) ||
+        !snapshot.read(a.inputs) || !particles.load(snapshot))
+        return false;
 
-            if (e->cInput->left)
-                m_input.x = -1;
-            else if (e->cInput->right)
-                m_input.x = 1;
-            else
-                m_input.x = 0;
+    size_t counts[6] = {};
+    for (auto& r : a.entities) {
+        if (r.tag >= tags.size()) return false;
+        for (int c = 0; c < 6; c++) counts[c] += (r.components >> c) & 1;
+    }
+    if (counts[0] != a.transforms.size() || counts[1] != a.shapes.size() ||
+        counts[2] != a.collisions.size() || counts[3] != a.scores.size() ||
+        counts[4] != a.lifespans.size() || counts[5] != a.inputs.size())
+        return false;
+
+    m_manager.clear(totalEntities);
+    size_t t = 0, s = 0, c = 0, sc = 0, l = 0, in = 0;
+    for (auto& r : a.entities) {
+        auto e = m_manager.restoreEntity(tags[r.tag], r.id, r.pending);
+        if (r.components & HAS_TRANSFORM) {
+            const TransformRecord& tr = a.transforms[t++];
+            e->cTransform = std::make_shared<CTransform>(
+                Vec2(tr.x, tr.y), Vec2(tr.vx, tr.vy), tr.angle, tr.friction,
+                tr.speed);
+            e->cTransform->prevPos = Vec2(tr.prevX, tr.prevY);
+        }
+        if (r.components & HAS_SHAPE) {
+            const ShapeRecord& sr = a.shapes[s++];
+            e->cShape = std::make_shared<CShape>(sr.radius, sr.points, sr.fill,
+                                                 sr.outline, sr.thickness);
+        }
+        if (r.components & HAS_COLLISION)
+            e->cCollision = std::make_shared<CCollision>(a.collisions[c++]);
+        if (r.components & HAS_SCORE)
+            e->cScore = std::make_shared<CScore>(a.scores[sc++]);
+        if (r.components & HAS_LIFESPAN) {
+            e->cLifespan = std::make_shared<CLifespan>(a.lifespans[l].total);
+            e->cLifespan->expiry = a.lifespans[l++].expiry;
+        }
+        if (r.components & HAS_INPUT) {
+            const InputRecord& ir = a.inputs[in++];
+            e->cInput = std::make_shared<CInput>();
+            e->cInput->up = ir.up;
+            e->cInput->down = ir.down;
+            e->cInput->left = ir.left;
+            e->cInput->right = ir.right;
+            e->cInput->shoot = ir.shoot;
         }
     }
+
+    m_currentTick = tick;
+    m_lifespanTick = lifespanTick;
+    m_currentFrame = frame;
+    m_paused = paused;
+    m_score = score;
+    m_lastNormalShoot = lastNormalShoot;
+    m_lastSpecialShoot = lastSpecialShoot;
+    m_input = input;
+    m_spawnerRandom = random;
+    m_particles = std::move(particles);
+
+    // Pending entities are scheduled when the next update() adds them.
+    m_lifespans.reset(m_lifespanTick);
+    for (auto& e : m_manager.getEntities())
+        if (e->cLifespan) m_lifespans.schedule(e, e->cLifespan->expiry);
+
+    m_snapshotMicroseconds = clock.getElapsedTime().asMicroseconds();
+    return true;
 }
 
-void Game::spawnWeapon() {
-    if (m_manager.getEntities("player").empty()) return;
-    if (m_currentFrame - m_lastNormalShoot < m_delayNormalWeapon) return;
-    m_lastNormalShoot = m_currentFrame;
+bool Game::saveSnapshot(const std::string& path) {
+    Snapshot snapshot;
+    saveSnapshot(snapshot);
+    if (!snapshot.save(path)) {
+        std::cerr << "Failed to save " << path << " :(\n";
+        return false;
+    }
+    std::cout << "Saved snapshot of tick " << m_currentTick << " to " << path
+              << ": " << snapshot.size() << " bytes in "
+              << m_snapshotMicroseconds << " us\n";
+    return true;
+}
 
-    sf::Mouse::getPosition(m_window).x, sf::Mouse::getPosition(m_window).y;
+bool Game::loadSnapshot(const std::string& path) {
+    Snapshot snapshot;
+    if (!snapshot.load(path) || !loadSnapshot(snapshot)) {
+        std::cerr << "Failed to load snapshot " << path << " :(\n";
+        return false;
+    }
+    std::cout << "Loaded snapshot of tick " << m_currentTick << " from "
+              << path << ": " << snapshot.size() << " bytes in "
+              << m_snapshotMicroseconds << " us\n";
+    return true;
+}
+
+void Game::processInput() {
+    uint8_t held = m_tickInput.held;
+    if (held & TickInput::UP)
+        m_input.y = -1;
+    else if (held & TickInput::DOWN)
+        m_input.y = 1;
+    else
+        m_input.y = 0;
+
+    if (held & TickInput::LEFT)
+        m_input.x = -1;
+    else if (held & TickInput::RIGHT)
+        m_input.x = 1;
+    else
+        m_input.x = 0;
+}
+
+void Game::spawnWeapon(const Vec2& target) {
+    if (m_manager.getEntities("player").empty()) return;
+    if (m_currentTick - m_lastNormalShoot < m_delayNormalWeapon) return;
+    m_lastNormalShoot = m_currentTick;
+    spawnBullet(target);
+}
 
-    Vec2 dir = {sf::Mouse::getPosition(m_window).x,
-                sf::Mouse::getPosition(m_window).y};
+void Game::spawnBullet(const Vec2& target) {
+    if (m_manager.getEntities("player").empty()) return;
+    Vec2 dir = target;
     Vec2 pos = m_manager.getEntities("player")[0]->cTransform->pos;
     float angle = m_manager.getEntities("player")[0]->cTransform->angle;
 
@@ -227,12 +883,13 @@ void Game::spawnWeapon() {
     e->cLifespan = std::make_shared<CLifespan>(m_bulletConfig.L);
 }
 
-void Game::spawnSpecialWeapon() {
-    if (m_currentFrame - m_lastSpecialShoot < m_delaySpecialWeapon) return;
-    m_lastSpecialShoot = m_delaySpecialWeapon;
-    Vec2 pos = {sf::Mouse::getPosition(m_window).x,
-                sf::Mouse::getPosition(m_window).y};
+void Game::spawnSpecialWeapon(const Vec2& pos) {
+    if (m_currentTick - m_lastSpecialShoot < m_delaySpecialWeapon) return;
+    m_lastSpecialShoot = m_currentTick;
+    spawnSpecialBullet(pos);
+}
 
+void Game::spawnSpecialBullet(const Vec2& pos) {
     auto e = m_manager.addEntity("specialbullet");
     e->cTransform = std::make_shared<CTransform>(pos, Vec2(0, 0), 0, 0,
                                                  m_bulletConfig.S / 2);
@@ -244,14 +901,15 @@ void Game::spawnSpecialWeapon() {
 }
 
 void Game::sCollision() {
+    PROFILE_ZONE_N("sCollision", m_manager.getEntities().size());
     for (auto& e : m_manager.getEntities()) {
         if (e->tag() == "specialbullet") continue;
         if (e->cCollision && e->cTransform) {
             Vec2 pos = e->cTransform->pos;
             float speed = e->cTransform->speed;
             float radius = e->cCollision->radius;
-            float screenWidth = m_window.getView().getSize().x;
-            float screenHeight = m_window.getView().getSize().y;
+            float screenWidth = m_windowConfig.W;
+            float screenHeight = m_windowConfig.H;
 
             if (pos.x - radius <= 0) e->cTransform->velocity.x = speed;
             if (pos.x + radius >= screenWidth)
@@ -270,7 +928,7 @@ void Game::sCollision() {
             float enemyRadius = enemy->cCollision->radius;
 
             if (bulletPos.dist(enemyPos) <= bulletRadius + enemyRadius) {
-                enemyDeadEffect(enemy);
+                enemyDeadEffect(enemy, false);
                 bullet->destroy();
                 enemy->destroy();
                 if (!m_manager.getEntities("player").empty())
@@ -300,7 +958,7 @@ void Game::sCollision() {
             float enemyRadius = enemy->cCollision->radius;
 
             if (enemyPos.dist(playerPos) <= playerRadius + enemyRadius) {
-                enemyDeadEffect(enemy);
+                enemyDeadEffect(enemy, true);
                 enemy->destroy();
                 sPlayerSpawner();
             }
@@ -321,7 +979,11 @@ void Game::sCollision() {
     }
 }
 
-void Game::enemyDeadEffect(const std::shared_ptr<Entity>& enemy) {
+// Shatters an enemy into minienemie shards, which can still be shot for
+// points and slowed. An enemy that crashed into the player also throws a
+// burst of sparks; those are particles and purely visual.
+void Game::enemyDeadEffect(const std::shared_ptr<Entity>& enemy,
+                           bool crashed) {
     int vertices = enemy->cShape->shape.getPointCount();
     float collisionRadius = enemy->cCollision->radius;
     float shapeRadius = enemy->cShape->shape.getRadius();
@@ -338,6 +1000,10 @@ void Game::enemyDeadEffect(const std::shared_ptr<Entity>& enemy) {
         float theta = i * M_PI / 180.0;
         Vec2 dir(cos(theta), sin(theta));
 
+        if (crashed)
+            m_particles.emit(pos, dir * speed * 2, angle, shapeRadius / 6.0, 3,
+                             outline, outline, 0, m_enemyConfig.L / 2);
+
         auto e = m_manager.addEntity("minienemie");
         e->cCollision = std::make_shared<CCollision>(collisionRadius / 3.0);
         e->cShape = std::make_shared<CShape>(shapeRadius / 3.0, vertices, fill,
@@ -347,9 +1013,37 @@ void Game::enemyDeadEffect(const std::shared_ptr<Entity>& enemy) {
     }
 }
 
+// Shatters up to count live enemies into shards, as if shot.
+int Game::explodeEnemies(int count) {
+    int exploded = 0;
+    for (auto& enemy : m_manager.getEntities("enemy")) {
+        if (exploded == count) break;
+        if (!enemy->isAlive()) continue;
+        enemyDeadEffect(enemy, false);
+        enemy->destroy();
+        exploded++;
+    }
+    return exploded;
+}
+
+size_t Game::entityCount() { return m_manager.getEntities().size(); }
+
+size_t Game::entityCount(const std::string& tag) {
+    return m_manager.getEntities(tag).size();
+}
+
+Vec2 Game::worldSize() const {
+    return Vec2(m_windowConfig.W, m_windowConfig.H);
+}
+
 void Game::sMovement() {
-    for (auto& e : m_manager.getEntities()) {
-        if (e->cTransform) {
+    PROFILE_ZONE_N("sMovement", m_manager.getEntities().size());
+    const EntityVec& entities = m_manager.getEntities();
+    m_jobs->parallelFor(0, entities.size(), 256, [&](size_t begin, size_t end) {
+        PROFILE_ZONE_N("sMovement chunk", end - begin);
+        for (size_t i = begin; i < end; i++) {
+            auto& e = entities[i];
+            if (!e->cTransform) continue;
             if (!m_paused) {
                 float speed = e->cTransform->speed;
 
@@ -377,7 +1071,7 @@ void Game::sMovement() {
             }
             e->cTransform->angle++;
         }
-    }
+    });
     for (auto& e : m_manager.getEntities("specialbullet")) {
         e->cCollision->radius++;
         float radius = e->cShape->shape.getRadius();
@@ -387,6 +1081,7 @@ void Game::sMovement() {
 }
 
 void Game::sGUI() {
+    PROFILE_ZONE("sGUI");
     ImGui::Begin("Geometry Wars");
     ImGui::BeginTabBar("bar");
 
@@ -395,6 +1090,47 @@ void Game::sGUI() {
         ImGui::Checkbox("Lifespan", &m_lifespanSystem);
         ImGui::Checkbox("Collision", &m_collisionSystem);
         ImGui::Checkbox("Spawning", &m_enemySpawnerSystem);
+        ImGui::Checkbox("Particles", &m_particleSystem);
+        ImGui::Text("Particles: %zu / %zu", m_particles.size(),
+                    m_particles.capacity());
+        ImGui::Checkbox("Level of detail", &m_lodSystem);
+        ImGui::Text("Vertices: %zu (saved %zu)", m_batch.getVertexCount(),
+                    m_batch.getSavedVertexCount());
+        ImGui::Text("Tick %d (%d this frame)", m_currentTick,
+                    m_ticksLastFrame);
+        ImGui::SliderInt("Soak ticks per frame", &m_soakTicks, 0, 1000);
+        ImGui::Text("%.0f ticks/s, %.0f entities/s", m_ticksPerSecond,
+                    m_entitiesPerSecond);
+        if (m_recordingInput)
+            ImGui::Text("Recording input to %s", m_options.record.c_str());
+        if (m_replayingInput)
+            ImGui::Text("Replaying tick %zu of %zu", m_replayTick,
+                        m_recording.size());
+        ImGui::Text("Snapshot (F5 save, F9 load): %zu bytes, %.1f us",
+                    m_quickSave.size(), m_snapshotMicroseconds);
+
+        ImGui::Checkbox("Run systems in parallel", &m_scheduler.parallel);
+        for (auto& s : m_scheduler.systems()) {
+            std::string after;
+            for (size_t d : s.dependencies)
+                after += (after.empty() ? "" : ", ") +
+                         m_scheduler.systems()[d].name;
+            ImGui::Text("%-10s %6.3f ms  after: %s", s.name.c_str(),
+                        s.milliseconds, after.empty() ? "-" : after.c_str());
+        }
+        ImGui::EndTabItem();
+    }
+    if (ImGui::BeginTabItem("Profiler")) {
+        guiProfiler();
+        ImGui::EndTabItem();
+    }
+    m_memoryTab = ImGui::BeginTabItem("Memory");
+    if (m_memoryTab) {
+        guiMemory();
+        ImGui::EndTabItem();
+    }
+    if (ImGui::BeginTabItem("Frame times")) {
+        guiFrameTimes();
         ImGui::EndTabItem();
     }
     if (ImGui::BeginTabItem("Entities")) {
@@ -462,60 +1198,282 @@ void Game::sGUI() {
     ImGui::End();
 }
 
-void Game::sRender() {
-    m_window.clear();
-    ImGui::SFML::Render(m_window);
+// Dumps the last --trace-seconds of profiling zones to the --trace file.
+void Game::writeTrace() {
+#if PROFILER_ENABLED
+    std::string path = m_options.trace.empty() ? "trace.json" : m_options.trace;
+    if (Profiler::get().writeTrace(path, m_options.traceSeconds))
+        std::cout << "Wrote the last " << m_options.traceSeconds
+                  << " s of zones to " << path << "\n";
+    else
+        std::cerr << "Failed to write " << path << " :(\n";
+#else
+    std::cerr << "Profiling zones are compiled out, no trace written\n";
+#endif
+}
+
+void Game::writeSamples() {
+    SamplingProfiler& sampler = SamplingProfiler::get();
+    sampler.stop();
+    if (!sampler.writeCollapsed(m_options.sample)) {
+        std::cerr << "Failed to write " << m_options.sample << " :(\n";
+        return;
+    }
+    std::cout << sampler.samples() << " samples (" << sampler.dropped()
+              << " dropped) written to " << m_options.sample << "\n";
+}
+
+// Zones are summed per frame; "budget" is the share of 1/FPS seconds.
+void Game::guiProfiler() {
+#if PROFILER_ENABLED
+    Profiler& profiler = Profiler::get();
+    float budget = 1000.0f / (m_windowConfig.FPS > 0 ? m_windowConfig.FPS : 60);
+    ImGui::Text("Frame budget %.2f ms, last %d frames", budget,
+                Profiler::HISTORY);
+
+#if ALLOC_TRACKING
+    Profiler::AllocationStats outside = profiler.allocations(-1);
+    uint64_t allocations = outside.count, bytes = outside.bytes;
+    for (int i = 0; i < profiler.zoneCount(); i++) {
+        allocations += profiler.allocations(i).count;
+        bytes += profiler.allocations(i).bytes;
+    }
+    ImGui::Text("Allocations last frame: %llu (%llu bytes), %llu outside zones",
+                (unsigned long long)allocations, (unsigned long long)bytes,
+                (unsigned long long)outside.count);
+    const int columns = 10;
+#else
+    const int columns = 8;
+#endif
+
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders |
+                            ImGuiTableFlags_SizingFixedFit;
+    if (ImGui::BeginTable("zones", columns, flags)) {
+        for (const char* header :
+             {"Zone", "Calls", "Last", "Min", "Avg", "p99", "Max", "Budget"})
+            ImGui::TableSetupColumn(header);
+#if ALLOC_TRACKING
+        ImGui::TableSetupColumn("Allocs");
+        ImGui::TableSetupColumn("Bytes");
+#endif
+        ImGui::TableHeadersRow();
+        for (int i = 0; i < profiler.zoneCount(); i++) {
+            Profiler::Stats s = profiler.stats(i);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", profiler.name(i).c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%d", s.calls);
+            for (float ms : {s.last, s.min, s.avg, s.p99, s.max}) {
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", ms);
+            }
+            ImGui::TableNextColumn();
+            ImGui::Text("%5.1f%%", 100 * s.avg / budget);
+#if ALLOC_TRACKING
+            Profiler::AllocationStats a = profiler.allocations(i);
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", (unsigned long long)a.count);
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", (unsigned long long)a.bytes);
+#endif
+        }
+        ImGui::EndTable();
+    }
+    guiCounters();
+
+    for (int i = 0; i < profiler.zoneCount(); i++) {
+        Profiler::Stats s = profiler.stats(i);
+        std::string overlay = "avg " + std::to_string(s.avg) + " ms";
+        ImGui::PlotLines(profiler.name(i).c_str(), profiler.history(i),
+                         Profiler::HISTORY, profiler.historyOffset(),
+                         overlay.c_str(), 0, std::max(s.max, budget),
+                         ImVec2(0, 40));
+    }
+#else
+    ImGui::Text("Profiling zones are compiled out (make PROFILER=0).");
+#endif
+}
+
+void Game::guiMemory() {
+    ImGui::Text("%zu bytes, %zu entity ids issued", m_memory.totalBytes(),
+                m_memory.ids());
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders |
+                            ImGuiTableFlags_SizingFixedFit;
+    if (!ImGui::BeginTable("memory", 6, flags)) return;
+    for (const char* header :
+         {"Storage", "Live", "Capacity", "Bytes", "Peak", "Fragmentation"})
+        ImGui::TableSetupColumn(header);
+    ImGui::TableHeadersRow();
+    for (auto& r : m_memory.rows()) {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::Text("%s", r.name.c_str());
+        for (size_t value : {r.live, r.capacity, r.bytes, r.peak}) {
+            ImGui::TableNextColumn();
+            ImGui::Text("%zu", value);
+        }
+        ImGui::TableNextColumn();
+        ImGui::Text("%.0f%%", 100 * r.fragmentation);
+    }
+    ImGui::EndTable();
+}
+
+// Percentiles since the start, or since the last reset.
+void Game::guiFrameTimes() {
+    uint64_t frames = m_frameTimes.histogram(FrameTimes::FRAME).count();
+    ImGui::Text("Missed vsync: %llu of %llu frames",
+                (unsigned long long)m_frameTimes.missedVsync(),
+                (unsigned long long)frames);
+    if (ImGui::Button("Reset")) m_frameTimes.clear();
+
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders |
+                            ImGuiTableFlags_SizingFixedFit;
+    if (!ImGui::BeginTable("frametimes", 5, flags)) return;
+    for (const char* header : {"ms", "p50", "p95", "p99", "Max"})
+        ImGui::TableSetupColumn(header);
+    ImGui::TableHeadersRow();
+    for (int i = 0; i < FrameTimes::COUNT; i++) {
+        const TimeHistogram& h = m_frameTimes.histogram(i);
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::Text("%s", FrameTimes::name(i));
+        for (int64_t us : {h.percentile(0.5), h.percentile(0.95),
+                           h.percentile(0.99), h.max()}) {
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", us / 1000.0);
+        }
+    }
+    ImGui::EndTable();
+}
+
+// Hardware counters of the last frame. Misses are shown per entity for the
+// zones that report how many entities they worked on.
+void Game::guiCounters() {
+    PerfCounters& perf = PerfCounters::get();
+    bool enabled = perf.enabled();
+    if (ImGui::Checkbox("Hardware counters", &enabled)) {
+        if (enabled)
+            perf.enable();
+        else
+            perf.disable();
+    }
+    if (!perf.enabled()) {
+        if (!perf.error().empty())
+            ImGui::TextWrapped("%s", perf.error().c_str());
+        return;
+    }
+
+    Profiler& profiler = Profiler::get();
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders |
+                            ImGuiTableFlags_SizingFixedFit;
+    if (!ImGui::BeginTable("counters", 6, flags)) return;
+    for (const char* header : {"Zone", "Cycles", "IPC", "L1D miss/entity",
+                               "LLC miss/entity", "Branch miss/entity"})
+        ImGui::TableSetupColumn(header);
+    ImGui::TableHeadersRow();
+    for (int i = 0; i < profiler.zoneCount(); i++) {
+        Profiler::CounterStats c = profiler.counters(i);
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::Text("%s", profiler.name(i).c_str());
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu",
+                    (unsigned long long)c.values[PerfCounters::CYCLES]);
+        ImGui::TableNextColumn();
+        if (c.values[PerfCounters::CYCLES] > 0)
+            ImGui::Text("%.2f", (double)c.values[PerfCounters::INSTRUCTIONS] /
+                                    c.values[PerfCounters::CYCLES]);
+        for (int counter : {PerfCounters::L1D_MISSES, PerfCounters::LLC_MISSES,
+                            PerfCounters::BRANCH_MISSES}) {
+            ImGui::TableNextColumn();
+            if (c.entities > 0)
+                ImGui::Text("%.3f", (double)c.values[counter] / c.entities);
+            else
+                ImGui::Text("-");
+        }
+    }
+    ImGui::EndTable();
+}
+
+void Game::sRender(float alpha) {
+    PROFILE_ZONE_N("sRender",
+                   m_manager.getEntities().size() + m_particles.size());
+    sf::Clock renderClock;
+    m_window->clear();
+    {
+        PROFILE_ZONE("ImGui::SFML::Render");
+        ImGui::SFML::Render(*m_window);
+    }
+
+    // LOD thresholds are in screen pixels, the batch works in world units.
+    float scale = m_window->getSize().x / m_window->getView().getSize().x;
+    size_t count = m_manager.getEntities().size() + m_particles.size();
+    m_batch.clear();
+    m_batch.setLod(m_lodSystem, m_lodConfig.SZ / scale, m_lodConfig.V,
+                   count > (size_t)m_lodConfig.N);
+
     for (auto& e : m_manager.getEntities()) {
         if (e->cTransform && e->cShape) {
-            e->cShape->shape.setPosition(e->cTransform->pos.x,
-                                         e->cTransform->pos.y);
-            e->cShape->shape.setRotation(e->cTransform->angle);
-            m_window.draw(e->cShape->shape);
+            const sf::CircleShape& shape = e->cShape->shape;
+            sf::Color fill = shape.getFillColor();
+            sf::Color outline = shape.getOutlineColor();
+
+            // Fade out over the lifespan; the shape colours stay untouched.
+            if (e->cLifespan) {
+                int remaining = e->cLifespan->expiry - m_lifespanTick;
+                float fade =
+                    (float)std::max(0, remaining) / e->cLifespan->total;
+                fill.a *= fade;
+                outline.a *= fade;
+            }
+
+            Vec2 pos = e->cTransform->prevPos +
+                       (e->cTransform->pos - e->cTransform->prevPos) * alpha;
+            m_batch.addPolygon(pos, shape.getRadius(),
+                               shape.getPointCount(), e->cTransform->angle,
+                               fill, outline, shape.getOutlineThickness());
         }
     }
-    m_text.setPosition(1, 1);
-    m_window.draw(m_text);
-    m_window.display();
+    m_particles.render(m_batch, alpha);
+    m_window->draw(m_batch);
+    m_window->draw(*m_hud);
+    // display() waits for the frame rate limit, which is not render time.
+    m_frameTimes.record(FrameTimes::RENDER,
+                        renderClock.getElapsedTime().asMicroseconds());
+    PROFILE_ZONE("display");
+    m_window->display();
 }
 
 void Game::sPlayerSpawner() {
+    PROFILE_ZONE("sPlayerSpawner");
     if (m_manager.getEntities("player").empty()) return;
     m_manager.getEntities("player")[0]->cTransform->pos = {
-        m_window.getSize().x / 2.0, m_window.getSize().y / 2.0};
+        m_windowConfig.W / 2.0, m_windowConfig.H / 2.0};
+    m_manager.getEntities("player")[0]->cTransform->prevPos =
+        m_manager.getEntities("player")[0]->cTransform->pos;
 
     m_manager.getEntities("player")[0]->cTransform->velocity = {0, 0};
     m_manager.getEntities("player")[0]->cScore->score = 0;
 }
 
+// Only entities that are due are visited; step() schedules every entity with
+// a lifespan when it is added.
 void Game::sLifespan() {
-    for (auto& e : m_manager.getEntities()) {
-        if (e->cLifespan) {
-            if (e->cLifespan->remaining == 0)
-                e->destroy();
-
-            else if (e->cShape) {
-                sf::Color c = e->cShape->shape.getFillColor();
-                e->cShape->shape.setFillColor(sf::Color(
-                    c.r, c.g, c.b,
-                    255.0 * e->cLifespan->remaining / e->cLifespan->total));
-
-                c = e->cShape->shape.getOutlineColor();
-                e->cShape->shape.setOutlineColor(sf::Color(
-                    c.r, c.g, c.b,
-                    255.0 * e->cLifespan->remaining / e->cLifespan->total));
-
-                e->cLifespan->remaining--;
-            }
-        }
-    }
+    PROFILE_ZONE_N("sLifespan", m_lifespans.size());
+    m_lifespans.advance(m_lifespanTick, m_expired);
+    for (auto& e : m_expired) e->destroy();
+    m_expired.clear();
+}
+
+void Game::sParticles() {
+    PROFILE_ZONE_N("sParticles", m_particles.size());
+    if (m_paused) return;
+    m_particles.update(m_windowConfig.W, m_windowConfig.H);
 }
 
 void Game::sScore() {
+    PROFILE_ZONE("sScore");
     if (m_manager.getEntities("player").empty()) return;
-    std::string s =
-        "Score " +
-        std::to_string(m_manager.getEntities("player")[0]->cScore->score);
-    m_text = sf::Text(s, m_font, m_fontConfig.SZ);
-    m_text.setFillColor(
-        sf::Color(m_fontConfig.R, m_fontConfig.G, m_fontConfig.B));
+    m_hud->setScore(m_manager.getEntities("player")[0]->cScore->score);
 }
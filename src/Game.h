@@ -1,6 +1,17 @@
 #include <SFML/Graphics.hpp>
 
 #include "EntityManager.h"
+#include "FrameTimes.h"
+#include "Hud.h"
+#include "Input.h"
+#include "JobSystem.h"
+#include "MemoryInspector.h"
+#include "ParticleSystem.h"
+#include "Random.h"
+#include "Scheduler.h"
+#include "Snapshot.h"
+#include "TimingWheel.h"
+#include "ShapeBatch.h"
 #include "imgui-SFML.h"
 #include "imgui.h"
 
@@ -20,29 +31,105 @@ struct EnemyConfig {
 struct BulletConfig {
     int SR, CR, S, FR, FG, FB, OR, OG, OB, OT, V, L;
 };
+struct ParticleConfig {
+    int N = 4096;
+};
+struct LodConfig {
+    int SZ = 12, N = 400, V = 5;
+};
+struct SimulationConfig {
+    int RATE = 60, MAX = 5;
+};
+struct JobsConfig {
+    int N = 0;
+};
+
+// Command line options. frames is the number of frames to render before
+// quitting, or of ticks to simulate in headless mode; 0 means no limit.
+struct GameOptions {
+    std::string config = "../bin/config.txt";
+    bool headless = false;
+    int frames = 0;
+    uint64_t seed = 0;
+    std::string record;
+    std::string replay;
+    std::string loadSnapshot;
+    std::string saveSnapshot;
+    int soak = 0;
+    std::string trace;
+    float traceSeconds = 10;
+    bool perfCounters = false;
+    std::string frameTimes;
+    std::string sample;
+    int sampleHz = 997;
+    bool memoryReport = false;
+};
 
 class Game {
-    sf::RenderWindow m_window;
+    GameOptions m_options;
+    std::unique_ptr<sf::RenderWindow> m_window;
     EntityManager m_manager;
+    ParticleSystem m_particles;
+    SystemScheduler m_scheduler;
+    std::unique_ptr<JobSystem> m_jobs;
+    RandomService m_random;
+    RandomStream m_spawnerRandom;
+    TimingWheel m_lifespans;
+    EntityVec m_expired;
+    ShapeBatch m_batch;
     sf::Font m_font;
-    sf::Text m_text;
+    std::unique_ptr<Hud> m_hud;
     sf::Clock m_deltaClock;
+    sf::Time m_accumulator;
+    FrameTimes m_frameTimes;
+    MemoryInspector m_memory;
+    bool m_memoryTab = false;
+    int m_memoryTick = 0;  // tick of the last memory sample
     int m_score = 0;
     int m_currentFrame = 0;
+    int m_currentTick = 0;
+    // Ticks the Lifespan system has run; lifespans are frozen while it is off.
+    int m_lifespanTick = 0;
+    int m_ticksLastFrame = 0;
+    int m_soakTicks = 0;
+    uint64_t m_entityTicks = 0;
+
+    sf::Clock m_throughputClock;
+    int m_throughputTick = 0;
+    uint64_t m_throughputEntityTicks = 0;
+    float m_ticksPerSecond = 0;
+    float m_entitiesPerSecond = 0;
     bool m_paused = false;
     bool m_running = true;
     bool m_movementSystem = true;
     bool m_collisionSystem = true;
     bool m_enemySpawnerSystem = true;
     bool m_lifespanSystem = true;
+    bool m_particleSystem = true;
+    bool m_lodSystem = true;
 
     WindowConfig m_windowConfig;
     FontConfig m_fontConfig;
     PlayerConfig m_playerConfig;
     EnemyConfig m_enemyConfig;
     BulletConfig m_bulletConfig;
+    ParticleConfig m_particleConfig;
+    LodConfig m_lodConfig;
+    SimulationConfig m_simulationConfig;
+    JobsConfig m_jobsConfig;
 
     Vec2 m_input = {0, 0};
+    TickInput m_liveInput;
+    TickInput m_tickInput;
+    EntityVec m_inputOwners;
+    size_t m_inputOwnersVersion = -1;
+    InputRecording m_recording;
+    bool m_recordingInput = false;
+    bool m_replayingInput = false;
+    size_t m_replayTick = 0;
+
+    Snapshot m_quickSave;
+    float m_snapshotMicroseconds = 0;
 
     int m_delayNormalWeapon = 40;
     int m_lastNormalShoot = -m_delayNormalWeapon;
@@ -51,21 +138,57 @@ class Game {
     int m_lastSpecialShoot = -m_delaySpecialWeapon; 
 
    public:
-    Game(const std::string config);
+    Game(const GameOptions& options);
     bool init(const std::string path);
-    void run();
+    bool initWindow();
+    bool run();
+    void runWindowed();
+    void runHeadless();
+    void printAllocations();
+    void step();
     void sMovement();
-    void sRender();
+    void sRender(float alpha);
     void sCollision();
     void sEnemySpawner();
     void sLifespan();
+    void sParticles();
     void sUserInput();
+    void sInput();
     void sScore();
+    void sThroughput();
+    void sMemory();
     void sGUI();
+    void guiProfiler();
+    void guiCounters();
+    void guiFrameTimes();
+    void guiMemory();
+    void writeTrace();
+    void writeSamples();
     void sPlayerSpawner();
-    void spawnWeapon();
-    void spawnSpecialWeapon();
+    void spawnWeapon(const Vec2& target);
+    void spawnSpecialWeapon(const Vec2& pos);
 
     void processInput();
-    void enemyDeadEffect(const std::shared_ptr<Entity>& enemy);
+    const EntityVec& inputOwners();
+    bool replayFinished() const;
+    bool finishInput();
+    uint64_t worldHash();
+
+    void saveSnapshot(Snapshot& snapshot);
+    bool loadSnapshot(Snapshot& snapshot);
+    bool saveSnapshot(const std::string& path);
+    bool loadSnapshot(const std::string& path);
+    void enemyDeadEffect(const std::shared_ptr<Entity>& enemy, bool crashed);
+
+    // Scripting, for the benchmarks: start() does what run() does before its
+    // loop, then the caller drives step() itself. The spawners act right
+    // away and ignore the weapon cooldowns.
+    void start();
+    void spawnEnemy();
+    void spawnBullet(const Vec2& target);
+    void spawnSpecialBullet(const Vec2& pos);
+    int explodeEnemies(int count);
+    size_t entityCount();
+    size_t entityCount(const std::string& tag);
+    Vec2 worldSize() const;
 };
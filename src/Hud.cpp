@@ -0,0 +1,94 @@
+#include "Hud.h"
+
+#include <algorithm>
+#include <cmath>
+
+Hud::Hud() : m_digits(sf::Triangles) {}
+
+Hud::GlyphQuad Hud::makeQuad(char c) const {
+    const sf::Glyph& glyph = m_font->getGlyph(c, m_size, false);
+
+    float left = glyph.bounds.left;
+    float top = glyph.bounds.top + m_size;
+    float right = left + glyph.bounds.width;
+    float bottom = top + glyph.bounds.height;
+
+    float u1 = glyph.textureRect.left;
+    float v1 = glyph.textureRect.top;
+    float u2 = u1 + glyph.textureRect.width;
+    float v2 = v1 + glyph.textureRect.height;
+
+    GlyphQuad quad;
+    quad.advance = glyph.advance;
+    quad.vertices[0] = sf::Vertex({left, top}, m_color, {u1, v1});
+    quad.vertices[1] = sf::Vertex({right, top}, m_color, {u2, v1});
+    quad.vertices[2] = sf::Vertex({left, bottom}, m_color, {u1, v2});
+    quad.vertices[3] = sf::Vertex({left, bottom}, m_color, {u1, v2});
+    quad.vertices[4] = sf::Vertex({right, top}, m_color, {u2, v1});
+    quad.vertices[5] = sf::Vertex({right, bottom}, m_color, {u2, v2});
+    return quad;
+}
+
+bool Hud::init(const sf::Font& font, unsigned size, const sf::Color& color,
+               const std::string& label) {
+    m_font = &font;
+    m_size = size;
+    m_color = color;
+
+    // Load every glyph before caching texture coordinates; the atlas may
+    // grow while glyphs are added but existing pixels keep their place.
+    for (char c = '0'; c <= '9'; c++) m_font->getGlyph(c, m_size, false);
+    m_font->getGlyph('-', m_size, false);
+    for (char c = '0'; c <= '9'; c++) m_glyphs[c - '0'] = makeQuad(c);
+    m_glyphs[10] = makeQuad('-');
+
+    sf::Text text(label, font, size);
+    text.setFillColor(color);
+    m_labelWidth = text.findCharacterPos(label.size()).x;
+
+    unsigned width = std::max(1.0f, std::ceil(m_labelWidth));
+    unsigned height = std::ceil(font.getLineSpacing(size));
+    if (!m_label.create(width, height)) return false;
+    m_label.clear(sf::Color::Transparent);
+    m_label.draw(text);
+    m_label.display();
+    m_labelSprite.setTexture(m_label.getTexture(), true);
+
+    m_dirty = true;
+    rebuild();
+    return true;
+}
+
+void Hud::setScore(int score) {
+    if (score == m_score && !m_dirty) return;
+    m_score = score;
+    m_dirty = true;
+    rebuild();
+}
+
+void Hud::rebuild() {
+    if (!m_font || !m_dirty) return;
+    m_dirty = false;
+
+    std::string s = std::to_string(m_score);
+    m_digits.resize(s.size() * 6);
+
+    float x = m_labelWidth;
+    for (size_t i = 0; i < s.size(); i++) {
+        const GlyphQuad& quad = m_glyphs[s[i] == '-' ? 10 : s[i] - '0'];
+        for (int k = 0; k < 6; k++) {
+            sf::Vertex v = quad.vertices[k];
+            v.position.x += x;
+            m_digits[i * 6 + k] = v;
+        }
+        x += quad.advance;
+    }
+}
+
+void Hud::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+    if (!m_font) return;
+    states.transform *= getTransform();
+    target.draw(m_labelSprite, states);
+    states.texture = &m_font->getTexture(m_size);
+    target.draw(m_digits, states);
+}
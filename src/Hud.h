@@ -0,0 +1,38 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <string>
+
+// Score overlay. The static label is rendered once into a texture and the
+// digit quads are cut from the font atlas up front, so the vertices are only
+// rebuilt when the score actually changes.
+class Hud : public sf::Drawable, public sf::Transformable {
+    struct GlyphQuad {
+        sf::Vertex vertices[6];
+        float advance = 0;
+    };
+
+    const sf::Font* m_font = nullptr;
+    unsigned m_size = 0;
+    sf::Color m_color;
+
+    sf::RenderTexture m_label;
+    sf::Sprite m_labelSprite;
+    float m_labelWidth = 0;
+
+    GlyphQuad m_glyphs[11];
+    sf::VertexArray m_digits;
+    int m_score = 0;
+    bool m_dirty = true;
+
+    GlyphQuad makeQuad(char c) const;
+    void rebuild();
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+   public:
+    Hud();
+
+    bool init(const sf::Font& font, unsigned size, const sf::Color& color,
+              const std::string& label);
+    void setScore(int score);
+};
@@ -0,0 +1,90 @@
+#include "Input.h"
+
+#include <algorithm>
+#include <fstream>
+
+static const char MAGIC[4] = {'G', 'W', 'I', 'R'};
+static const uint32_t VERSION = 3;
+
+// Fields are written one by one in host byte order, so recordings move
+// between little-endian machines but not to big-endian ones.
+template <class T>
+static void write(std::ofstream& out, const T& value) {
+    out.write((const char*)&value, sizeof(T));
+}
+
+template <class T>
+static bool read(std::ifstream& in, T& value) {
+    return (bool)in.read((char*)&value, sizeof(T));
+}
+
+InputRecording::InputRecording() {}
+
+void InputRecording::clear(uint64_t seed) {
+    m_seed = seed;
+    m_hash = 0;
+    m_ticks.clear();
+}
+
+void InputRecording::add(const TickInput& input) { m_ticks.push_back(input); }
+
+bool InputRecording::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+
+    out.write(MAGIC, sizeof(MAGIC));
+    write(out, VERSION);
+    write(out, m_seed);
+    write(out, m_hash);
+    write(out, (uint32_t)m_ticks.size());
+
+    for (size_t i = 0; i < m_ticks.size();) {
+        uint32_t run = 1;
+        while (i + run < m_ticks.size() && m_ticks[i + run] == m_ticks[i])
+            run++;
+        write(out, run);
+        write(out, m_ticks[i].held);
+        write(out, m_ticks[i].pressed);
+        write(out, m_ticks[i].mouseX);
+        write(out, m_ticks[i].mouseY);
+        i += run;
+    }
+    return (bool)out;
+}
+
+bool InputRecording::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[4];
+    uint32_t version, count;
+    if (!in.read(magic, sizeof(magic)) ||
+        !std::equal(magic, magic + 4, MAGIC) || !read(in, version) ||
+        version != VERSION || !read(in, m_seed) || !read(in, m_hash) ||
+        !read(in, count))
+        return false;
+
+    m_ticks.clear();
+    m_ticks.reserve(count);
+    while (m_ticks.size() < count) {
+        uint32_t run;
+        TickInput input;
+        if (!read(in, run) || !read(in, input.held) ||
+            !read(in, input.pressed) || !read(in, input.mouseX) ||
+            !read(in, input.mouseY) || run == 0 ||
+            run > count - m_ticks.size())
+            return false;
+        m_ticks.insert(m_ticks.end(), run, input);
+    }
+    return true;
+}
+
+uint64_t InputRecording::seed() const { return m_seed; }
+
+uint64_t InputRecording::hash() const { return m_hash; }
+
+void InputRecording::setHash(uint64_t hash) { m_hash = hash; }
+
+size_t InputRecording::size() const { return m_ticks.size(); }
+
+const TickInput& InputRecording::operator[](size_t tick) const {
+    return m_ticks[tick];
+}
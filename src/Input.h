@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Everything the player can do in one tick, built once per tick and not
+// changed afterwards. held has a bit for every key and button that is down;
+// pressed has the ones that went down since the previous tick, even if they
+// were released again before it. Movement reads held; pause and the weapons
+// read pressed too, so a tap shorter than a tick still counts. The mouse
+// position only matters while a button is held or pressed, so it is zero
+// otherwise; that keeps consecutive ticks equal and the recording small.
+struct TickInput {
+    enum : uint8_t {
+        UP = 1 << 0,
+        DOWN = 1 << 1,
+        LEFT = 1 << 2,
+        RIGHT = 1 << 3,
+        PAUSE = 1 << 4,
+        SHOOT = 1 << 5,
+        SPECIAL = 1 << 6,
+    };
+    uint8_t held = 0;
+    uint8_t pressed = 0;
+    int16_t mouseX = 0;
+    int16_t mouseY = 0;
+
+    bool operator==(const TickInput& other) const = default;
+};
+
+// The input of every tick of a run, plus the seed and the world hash at the
+// end. Saved as a header followed by run-length encoded ticks.
+class InputRecording {
+    uint64_t m_seed = 0;
+    uint64_t m_hash = 0;
+    std::vector<TickInput> m_ticks;
+
+   public:
+    InputRecording();
+
+    void clear(uint64_t seed);
+    void add(const TickInput& input);
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    uint64_t seed() const;
+    uint64_t hash() const;
+    void setHash(uint64_t hash);
+    size_t size() const;
+    const TickInput& operator[](size_t tick) const;
+};
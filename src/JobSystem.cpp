@@ -0,0 +1,127 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+#include "Profiler.h"
+
+// Identifies the deque of the calling thread. Threads that are not workers
+// of this system share deque 0 with the thread that created it.
+static thread_local const JobSystem* t_system = nullptr;
+static thread_local size_t t_index = 0;
+
+class SpinLock {
+    std::atomic_flag& m_flag;
+
+   public:
+    SpinLock(std::atomic_flag& flag) : m_flag(flag) {
+        while (m_flag.test_and_set(std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+    ~SpinLock() { m_flag.clear(std::memory_order_release); }
+};
+
+bool JobSystem::Deque::push(const Job& job) {
+    SpinLock guard(lock);
+    if (tail - head == CAPACITY) return false;
+    jobs[tail++ % CAPACITY] = job;
+    return true;
+}
+
+bool JobSystem::Deque::pop(Job& job) {
+    SpinLock guard(lock);
+    if (tail == head) return false;
+    job = jobs[--tail % CAPACITY];
+    return true;
+}
+
+bool JobSystem::Deque::steal(Job& job) {
+    SpinLock guard(lock);
+    if (tail == head) return false;
+    job = jobs[head++ % CAPACITY];
+    return true;
+}
+
+JobSystem::JobSystem(size_t threads)
+    : m_deques(new Deque[std::max((size_t)1, threads)]),
+      m_threads(std::max((size_t)1, threads)) {
+    t_system = this;
+    t_index = 0;
+    for (size_t i = 1; i < m_threads; i++)
+        m_workers.emplace_back(&JobSystem::work, this, i);
+}
+
+JobSystem::~JobSystem() {
+    m_stopping = true;
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_wake.notify_all();
+    for (auto& w : m_workers) w.join();
+    if (t_system == this) t_system = nullptr;
+}
+
+size_t JobSystem::threadIndex() const { return t_system == this ? t_index : 0; }
+
+void JobSystem::execute(const Job& job) {
+    job.function(job.data, job.begin, job.end);
+    if (job.counter) job.counter->fetch_sub(1, std::memory_order_release);
+}
+
+bool JobSystem::tryRun(size_t self) {
+    Job job;
+    bool found = m_deques[self].pop(job);
+    for (size_t k = 1; k < m_threads && !found; k++)
+        found = m_deques[(self + k) % m_threads].steal(job);
+    if (!found) return false;
+
+    m_queued--;
+    execute(job);
+    return true;
+}
+
+// Workers spin briefly when they run out of jobs and then sleep until a
+// job is submitted, so an idle game does not keep every core busy.
+void JobSystem::work(size_t index) {
+    t_system = this;
+    t_index = index;
+    Profiler::get().setThreadName("worker " + std::to_string(index));
+
+    int idle = 0;
+    while (!m_stopping) {
+        if (tryRun(index)) {
+            idle = 0;
+        } else if (idle++ < 64) {
+            std::this_thread::yield();
+        } else {
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_sleeping++;
+            m_wake.wait(lock, [this] { return m_queued > 0 || m_stopping; });
+            m_sleeping--;
+            idle = 0;
+        }
+    }
+}
+
+void JobSystem::submit(const Job& job) {
+    if (job.counter) job.counter->fetch_add(1, std::memory_order_relaxed);
+    if (m_threads == 1 || !m_deques[threadIndex()].push(job)) {
+        execute(job);
+        return;
+    }
+
+    m_queued++;
+    if (m_sleeping > 0) {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+        }
+        m_wake.notify_one();
+    }
+}
+
+void JobSystem::wait(const JobCounter& counter) {
+    size_t self = threadIndex();
+    while (counter.load(std::memory_order_acquire) > 0)
+        if (!tryRun(self)) std::this_thread::yield();
+}
+
+size_t JobSystem::size() const { return m_threads; }
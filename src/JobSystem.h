@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+typedef std::atomic<int> JobCounter;
+
+// A job is a function over an index range. Submitting a job increments its
+// counter and finishing it decrements the counter, so a counter reaching
+// zero means every job attached to it (including jobs those jobs submitted
+// on the same counter) is done.
+struct Job {
+    void (*function)(void* data, size_t begin, size_t end) = nullptr;
+    void* data = nullptr;
+    size_t begin = 0;
+    size_t end = 0;
+    JobCounter* counter = nullptr;
+};
+
+// Work-stealing job system. Every thread owns a deque; it pushes and pops
+// its own jobs at the back and steals from the front of other deques when
+// it runs dry. The thread that created the system takes part while it
+// waits on a counter.
+class JobSystem {
+    struct alignas(64) Deque {
+        static const size_t CAPACITY = 1024;
+        std::atomic_flag lock = ATOMIC_FLAG_INIT;
+        size_t head = 0;
+        size_t tail = 0;
+        Job jobs[CAPACITY];
+
+        bool push(const Job& job);
+        bool pop(Job& job);
+        bool steal(Job& job);
+    };
+
+    std::vector<std::thread> m_workers;
+    std::unique_ptr<Deque[]> m_deques;
+    size_t m_threads;
+
+    std::atomic<int> m_queued{0};
+    std::atomic<int> m_sleeping{0};
+    std::atomic<bool> m_stopping{false};
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+
+    size_t threadIndex() const;
+    bool tryRun(size_t self);
+    void execute(const Job& job);
+    void work(size_t index);
+
+   public:
+    JobSystem(size_t threads);
+    ~JobSystem();
+
+    void submit(const Job& job);
+    void wait(const JobCounter& counter);
+
+    // Calls f(begin, end) over chunks of at most grain indices and returns
+    // when all of them are done.
+    template <class F>
+    void parallelFor(size_t begin, size_t end, size_t grain, F&& f);
+
+    size_t size() const;
+};
+
+template <class F>
+void JobSystem::parallelFor(size_t begin, size_t end, size_t grain, F&& f) {
+    if (grain == 0) grain = 1;
+    if (m_threads == 1 || end - begin <= grain) {
+        if (begin < end) f(begin, end);
+        return;
+    }
+
+    JobCounter counter{0};
+    Job job;
+    job.function = [](void* data, size_t b, size_t e) {
+        (*static_cast<std::remove_reference_t<F>*>(data))(b, e);
+    };
+    job.data = (void*)&f;
+    job.counter = &counter;
+    for (size_t b = begin; b < end; b += grain) {
+        job.begin = b;
+        job.end = std::min(end, b + grain);
+        submit(job);
+    }
+    wait(counter);
+}
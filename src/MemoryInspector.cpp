@@ -0,0 +1,143 @@
+#include "MemoryInspector.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+
+namespace {
+
+// glibc malloc hands out 16-byte aligned chunks with an 8-byte header, and
+// none smaller than 32 bytes.
+size_t chunk(size_t bytes) {
+    return std::max<size_t>(32, (bytes + 8 + 15) & ~(size_t)15);
+}
+
+// The control block of a shared_ptr: a vtable pointer and two counts.
+// make_shared puts the object right behind it in the same allocation;
+// shared_ptr<T>(new T) allocates it separately, with the pointer in it.
+const size_t CONTROL_BLOCK = sizeof(void*) + 2 * sizeof(int);
+
+// Objects that each have their own heap allocation of the same size.
+struct HeapObjects {
+    std::string name;
+    size_t bytesEach;
+    size_t count = 0;
+    uintptr_t low = UINTPTR_MAX, high = 0;
+
+    void add(const void* p) {
+        if (!p) return;
+        count++;
+        low = std::min(low, (uintptr_t)p);
+        high = std::max(high, (uintptr_t)p);
+    }
+
+    MemoryInspector::Row row() const {
+        MemoryInspector::Row r;
+        r.name = name;
+        r.live = r.capacity = count;
+        r.bytes = count * bytesEach;
+        if (count > 1)
+            r.fragmentation = std::max(
+                0.0, 1 - (double)r.bytes / (high - low + bytesEach));
+        return r;
+    }
+};
+
+template <class T>
+HeapObjects component(const char* name) {
+    return {name, chunk(CONTROL_BLOCK + sizeof(T))};
+}
+
+MemoryInspector::Row vectorRow(const std::string& name, const EntityVec& v) {
+    MemoryInspector::Row r;
+    r.name = name;
+    r.live = v.size();
+    r.capacity = v.capacity();
+    r.bytes = v.capacity() * sizeof(EntityVec::value_type);
+    if (r.capacity > 0) r.fragmentation = 1 - (float)r.live / r.capacity;
+    return r;
+}
+
+}  // namespace
+
+MemoryInspector::MemoryInspector() {}
+
+void MemoryInspector::add(Row row) {
+    size_t& peak = m_peaks[row.name];
+    peak = std::max(peak, row.live);
+    row.peak = peak;
+    m_rows.push_back(row);
+}
+
+void MemoryInspector::sample(EntityManager& manager,
+                             const ParticleSystem& particles) {
+    m_rows.clear();
+    m_ids = manager.getTotalEntities();
+    add(vectorRow("entity slots", manager.getEntities()));
+    add(vectorRow("pending adds", manager.getPendingEntities()));
+
+    HeapObjects entities = {"entity objects",
+                            chunk(sizeof(Entity)) +
+                                chunk(CONTROL_BLOCK + sizeof(void*))};
+    HeapObjects transforms = component<CTransform>("CTransform");
+    HeapObjects shapes = component<CShape>("CShape");
+    HeapObjects collisions = component<CCollision>("CCollision");
+    HeapObjects scores = component<CScore>("CScore");
+    HeapObjects lifespans = component<CLifespan>("CLifespan");
+    HeapObjects inputs = component<CInput>("CInput");
+    for (const EntityVec* v :
+         {&manager.getEntities(), &manager.getPendingEntities()}) {
+        for (auto& e : *v) {
+            entities.add(e.get());
+            transforms.add(e->cTransform.get());
+            shapes.add(e->cShape.get());
+            collisions.add(e->cCollision.get());
+            scores.add(e->cScore.get());
+            lifespans.add(e->cLifespan.get());
+            inputs.add(e->cInput.get());
+        }
+    }
+    for (auto* heap : {&entities, &transforms, &shapes, &collisions, &scores,
+                       &lifespans, &inputs})
+        add(heap->row());
+
+    for (auto& [tag, v] : manager.getEntityMap())
+        add(vectorRow("tag " + tag, v));
+
+    Row r;
+    r.name = "particles";
+    r.live = particles.size();
+    r.capacity = particles.capacity();
+    r.bytes = particles.bytes();
+    if (r.capacity > 0) r.fragmentation = 1 - (float)r.live / r.capacity;
+    add(r);
+}
+
+const std::vector<MemoryInspector::Row>& MemoryInspector::rows() const {
+    return m_rows;
+}
+
+size_t MemoryInspector::ids() const { return m_ids; }
+
+size_t MemoryInspector::totalBytes() const {
+    size_t bytes = 0;
+    for (auto& r : m_rows) bytes += r.bytes;
+    return bytes;
+}
+
+void MemoryInspector::report(std::ostream& out) const {
+    out << "memory: " << totalBytes() << " bytes, " << m_ids
+        << " entity ids issued\n";
+    out << "  " << std::left << std::setw(20) << "storage" << std::right
+        << std::setw(10) << "live" << std::setw(10) << "capacity"
+        << std::setw(12) << "bytes" << std::setw(10) << "peak"
+        << std::setw(8) << "frag" << "\n";
+    for (auto& r : m_rows) {
+        out << "  " << std::left << std::setw(20) << r.name << std::right
+            << std::setw(10) << r.live << std::setw(10) << r.capacity
+            << std::setw(12) << r.bytes << std::setw(10) << r.peak
+            << std::setw(7) << std::fixed << std::setprecision(0)
+            << 100 * r.fragmentation << "%\n"
+            << std::defaultfloat;
+    }
+}
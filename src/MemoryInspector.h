@@ -0,0 +1,48 @@
+#pragma once
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "EntityManager.h"
+#include "ParticleSystem.h"
+
+// Sizes of the entity and component storage, for sizing pools and spotting
+// growth. Each sample() walks every entity once.
+//
+// Vectors report their size, capacity, bytes of capacity and the unused share
+// of the capacity as fragmentation. Entities and components are separate
+// heap allocations, so for them capacity equals the live count, bytes are
+// the estimated heap chunks including shared_ptr control blocks, and
+// fragmentation is the share of the address range they span that holds
+// something else: 0 when they are packed as in a pool. Peaks are the highest
+// live count over all samples.
+class MemoryInspector {
+   public:
+    struct Row {
+        std::string name;
+        size_t live = 0, capacity = 0, bytes = 0, peak = 0;
+        float fragmentation = 0;
+    };
+
+   private:
+    std::vector<Row> m_rows;
+    std::map<std::string, size_t> m_peaks;
+    size_t m_ids = 0;
+
+    void add(Row row);
+
+   public:
+    MemoryInspector();
+
+    void sample(EntityManager& manager, const ParticleSystem& particles);
+
+    const std::vector<Row>& rows() const;
+    // Ids handed out so far. They are never reused, so this keeps growing
+    // while the live count stays flat.
+    size_t ids() const;
+    size_t totalBytes() const;
+
+    void report(std::ostream& out) const;
+};
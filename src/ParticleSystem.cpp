@@ -0,0 +1,169 @@
+#include "ParticleSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+ParticleSystem::ParticleSystem(size_t capacity)
+    : m_capacity(capacity),
+      m_x(capacity),
+      m_y(capacity),
+      m_vx(capacity),
+      m_vy(capacity),
+      m_angle(capacity),
+      m_radius(capacity),
+      m_thickness(capacity),
+      m_remaining(capacity),
+      m_total(capacity),
+      m_points(capacity),
+      m_fill(capacity),
+      m_outline(capacity) {}
+
+void ParticleSystem::emit(const Vec2& pos, const Vec2& velocity, float angle,
+                          float radius, int points, const sf::Color& fill,
+                          const sf::Color& outline, float thickness,
+                          int lifespan) {
+    if (m_capacity == 0 || lifespan <= 0) return;
+    if (m_count == m_capacity) {
+        m_head = (m_head + 1) % m_capacity;
+        m_count--;
+    }
+
+    size_t i = (m_head + m_count++) % m_capacity;
+    m_x[i] = pos.x;
+    m_y[i] = pos.y;
+    m_vx[i] = velocity.x;
+    m_vy[i] = velocity.y;
+    m_angle[i] = angle;
+    m_radius[i] = radius;
+    m_thickness[i] = thickness;
+    m_remaining[i] = lifespan;
+    m_total[i] = lifespan;
+    m_points[i] = points;
+    m_fill[i] = fill;
+    m_outline[i] = outline;
+}
+
+// Branch-free and written against restrict-qualified parameters so the
+// compiler can vectorise it over the attribute arrays.
+static void updateParticles(float* __restrict x, float* __restrict y,
+                            float* __restrict vx, float* __restrict vy,
+                            float* __restrict angle,
+                            const float* __restrict radius,
+                            int* __restrict remaining, size_t n, float width,
+                            float height) {
+    for (size_t i = 0; i < n; i++) {
+        float r = radius[i];
+        float sx = std::fabs(vx[i]), sy = std::fabs(vy[i]);
+        float dx = x[i] + r >= width ? -sx : vx[i];
+        float dy = y[i] + r >= height ? -sy : vy[i];
+        dx = x[i] - r <= 0 ? sx : dx;
+        dy = y[i] - r <= 0 ? sy : dy;
+
+        vx[i] = dx;
+        vy[i] = dy;
+        x[i] += dx;
+        y[i] += dy;
+        angle[i] += 1;
+        remaining[i]--;
+    }
+}
+
+void ParticleSystem::updateRange(size_t begin, size_t end, float width,
+                                 float height) {
+    updateParticles(&m_x[begin], &m_y[begin], &m_vx[begin], &m_vy[begin],
+                    &m_angle[begin], &m_radius[begin], &m_remaining[begin],
+                    end - begin, width, height);
+}
+
+void ParticleSystem::update(float width, float height) {
+    if (m_count == 0) return;
+
+    size_t end = m_head + m_count;
+    updateRange(m_head, std::min(end, m_capacity), width, height);
+    if (end > m_capacity) updateRange(0, end - m_capacity, width, height);
+
+    while (m_count > 0 && m_remaining[m_head] <= 0) {
+        m_head = (m_head + 1) % m_capacity;
+        m_count--;
+    }
+}
+
+// Particles are drawn between their last two positions; stepping back along
+// the velocity is exact except on the tick a particle bounces.
+void ParticleSystem::render(ShapeBatch& batch, float alpha) const {
+    for (size_t k = 0; k < m_count; k++) {
+        size_t i = (m_head + k) % m_capacity;
+        if (m_remaining[i] <= 0) continue;
+
+        float fade = (float)m_remaining[i] / m_total[i];
+        sf::Color fill = m_fill[i], outline = m_outline[i];
+        fill.a *= fade;
+        outline.a *= fade;
+
+        float back = 1 - alpha;
+        batch.addPolygon(Vec2(m_x[i] - m_vx[i] * back, m_y[i] - m_vy[i] * back),
+                         m_radius[i], m_points[i], m_angle[i], fill, outline,
+                         m_thickness[i]);
+    }
+}
+
+void ParticleSystem::clear() {
+    m_head = 0;
+    m_count = 0;
+}
+
+size_t ParticleSystem::size() const { return m_count; }
+
+size_t ParticleSystem::capacity() const { return m_capacity; }
+
+size_t ParticleSystem::bytes() const {
+    return m_capacity * (7 * sizeof(float) + 3 * sizeof(int) +
+                         2 * sizeof(sf::Color));
+}
+
+// The attribute arrays are copied whole, ring layout included.
+void ParticleSystem::save(Snapshot& snapshot) const {
+    snapshot.write((uint64_t)m_head);
+    snapshot.write((uint64_t)m_count);
+    snapshot.write(m_x);
+    snapshot.write(m_y);
+    snapshot.write(m_vx);
+    snapshot.write(m_vy);
+    snapshot.write(m_angle);
+    snapshot.write(m_radius);
+    snapshot.write(m_thickness);
+    snapshot.write(m_remaining);
+    snapshot.write(m_total);
+    snapshot.write(m_points);
+    snapshot.write(m_fill);
+    snapshot.write(m_outline);
+}
+
+bool ParticleSystem::load(Snapshot& snapshot) {
+    uint64_t head, count;
+    ParticleSystem p;
+    if (!snapshot.read(head) || !snapshot.read(count) ||
+        !snapshot.read(p.m_x) || !snapshot.read(p.m_y) ||
+        !snapshot.read(p.m_vx) || !snapshot.read(p.m_vy) ||
+        !snapshot.read(p.m_angle) || !snapshot.read(p.m_radius) ||
+        !snapshot.read(p.m_thickness) || !snapshot.read(p.m_remaining) ||
+        !snapshot.read(p.m_total) || !snapshot.read(p.m_points) ||
+        !snapshot.read(p.m_fill) || !snapshot.read(p.m_outline))
+        return false;
+
+    size_t n = p.m_x.size();
+    for (size_t size :
+         {p.m_y.size(), p.m_vx.size(), p.m_vy.size(), p.m_angle.size(),
+          p.m_radius.size(), p.m_thickness.size(), p.m_remaining.size(),
+          p.m_total.size(), p.m_points.size(), p.m_fill.size(),
+          p.m_outline.size()})
+        if (size != n) return false;
+    if (count > n || (n > 0 && head >= n) || (n == 0 && head > 0))
+        return false;
+
+    p.m_capacity = n;
+    p.m_head = head;
+    p.m_count = count;
+    *this = std::move(p);
+    return true;
+}
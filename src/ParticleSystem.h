@@ -0,0 +1,42 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+#include "ShapeBatch.h"
+#include "Snapshot.h"
+#include "Vec2.h"
+
+// Fixed-capacity pool for purely cosmetic debris. Particles live in a ring
+// buffer stored as one array per attribute; when the pool is full the oldest
+// particle is overwritten.
+class ParticleSystem {
+    size_t m_capacity = 0;
+    size_t m_head = 0;
+    size_t m_count = 0;
+
+    std::vector<float> m_x, m_y, m_vx, m_vy;
+    std::vector<float> m_angle, m_radius, m_thickness;
+    std::vector<int> m_remaining, m_total, m_points;
+    std::vector<sf::Color> m_fill, m_outline;
+
+    void updateRange(size_t begin, size_t end, float width, float height);
+
+   public:
+    ParticleSystem(size_t capacity = 0);
+
+    void emit(const Vec2& pos, const Vec2& velocity, float angle, float radius,
+              int points, const sf::Color& fill, const sf::Color& outline,
+              float thickness, int lifespan);
+    void update(float width, float height);
+    void render(ShapeBatch& batch, float alpha) const;
+    void clear();
+
+    void save(Snapshot& snapshot) const;
+    bool load(Snapshot& snapshot);
+
+    size_t size() const;
+    size_t capacity() const;
+    // Bytes held by the attribute arrays.
+    size_t bytes() const;
+};
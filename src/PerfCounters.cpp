@@ -0,0 +1,128 @@
+#include "PerfCounters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+PerfCounters::PerfCounters() {}
+
+PerfCounters& PerfCounters::get() {
+    static PerfCounters counters;
+    return counters;
+}
+
+const char* PerfCounters::name(int counter) {
+    static const char* names[COUNT] = {"cycles", "instructions", "l1d_misses",
+                                       "llc_misses", "branch_misses"};
+    return names[counter];
+}
+
+#ifdef __linux__
+namespace {
+
+// The counters are opened as one group led by CYCLES, so that they are all
+// scheduled onto the PMU together and one read() returns all of them.
+struct ThreadCounters {
+    bool opened = false;
+    int error = 0;
+    int fds[PerfCounters::COUNT];
+    int slot[PerfCounters::COUNT];  // position in the group read, or -1
+
+    ~ThreadCounters() {
+        if (!opened || error) return;
+        for (int fd : fds)
+            if (fd >= 0) close(fd);
+    }
+
+    void open() {
+        opened = true;
+        const uint32_t cache = PERF_COUNT_HW_CACHE_L1D |
+                               PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                               PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+        const struct {
+            uint32_t type;
+            uint64_t config;
+        } events[PerfCounters::COUNT] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, cache},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        };
+
+        int slots = 0;
+        for (int i = 0; i < PerfCounters::COUNT; i++) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[i].type;
+            attr.config = events[i].config;
+            attr.disabled = i == 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1,
+                             i == 0 ? -1 : fds[0], 0);
+            if (fds[i] < 0 && i == 0) {
+                error = errno;
+                return;
+            }
+            slot[i] = fds[i] < 0 ? -1 : slots++;
+        }
+        ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    bool read(uint64_t values[PerfCounters::COUNT]) {
+        if (!opened) open();
+        if (error) return false;
+        uint64_t buffer[1 + PerfCounters::COUNT];
+        if (::read(fds[0], buffer, sizeof(buffer)) <= 0) return false;
+        for (int i = 0; i < PerfCounters::COUNT; i++)
+            values[i] = slot[i] < 0 ? 0 : buffer[1 + slot[i]];
+        return true;
+    }
+};
+
+thread_local ThreadCounters t_counters;
+
+}  // namespace
+
+bool PerfCounters::enable() {
+    uint64_t values[COUNT];
+    if (!t_counters.read(values)) {
+        m_error = std::string("perf_event_open failed: ") +
+                  strerror(t_counters.error);
+        std::ifstream paranoid("/proc/sys/kernel/perf_event_paranoid");
+        int level;
+        if (paranoid >> level)
+            m_error += " (perf_event_paranoid is " + std::to_string(level) +
+                       ")";
+        return false;
+    }
+    m_enabled.store(true);
+    return true;
+}
+
+bool PerfCounters::read(uint64_t values[COUNT]) {
+    return t_counters.read(values);
+}
+#else
+bool PerfCounters::enable() {
+    m_error = "hardware counters need Linux perf_event_open";
+    return false;
+}
+
+bool PerfCounters::read(uint64_t values[COUNT]) { return false; }
+#endif
+
+void PerfCounters::disable() { m_enabled.store(false); }
+
+const std::string& PerfCounters::error() const { return m_error; }
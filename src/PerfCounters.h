@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Hardware performance counters of the calling thread, read through Linux
+// perf_event_open. Each thread opens its own counter group the first time
+// it reads. The counters only count user space, which perf_event_paranoid
+// levels up to 2 allow for one's own threads. Where they can't be opened
+// (another OS, a container without the syscall, a stricter paranoid level)
+// enable() fails with a reason and read() keeps returning false.
+class PerfCounters {
+   public:
+    enum Counter {
+        CYCLES,
+        INSTRUCTIONS,
+        L1D_MISSES,
+        LLC_MISSES,
+        BRANCH_MISSES,
+        COUNT
+    };
+
+   private:
+    std::atomic<bool> m_enabled{false};
+    std::string m_error;
+
+    PerfCounters();
+
+   public:
+    static PerfCounters& get();
+    static const char* name(int counter);
+
+    // Starts counting on every thread that reads. Returns false and leaves
+    // counting off if the calling thread can't open the counters.
+    bool enable();
+    void disable();
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    // Why the last enable() failed.
+    const std::string& error() const;
+
+    // Current totals of the calling thread. Counters the CPU doesn't have
+    // read as 0.
+    bool read(uint64_t values[COUNT]);
+};
@@ -0,0 +1,253 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <new>
+
+// The innermost zone open on this thread, for allocation tracking.
+static thread_local int t_zone = -1;
+
+Profiler::Profiler() {}
+
+Profiler& Profiler::get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+uint64_t Profiler::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+int Profiler::zone(const char* name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int count = m_zoneCount.load();
+    for (int i = 0; i < count; i++)
+        if (m_zones[i].name == name) return i;
+    if (count == MAX_ZONES) return MAX_ZONES - 1;
+    m_zones[count].name = name;
+    m_zoneCount.store(count + 1);
+    return count;
+}
+
+Profiler::TraceBuffer& Profiler::threadBuffer() {
+    thread_local TraceBuffer* buffer = nullptr;
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_buffers.push_back(std::make_unique<TraceBuffer>());
+        buffer = m_buffers.back().get();
+        buffer->name = "thread " + std::to_string(m_buffers.size() - 1);
+    }
+    return *buffer;
+}
+
+void Profiler::add(int zone, uint64_t start, uint64_t end, int64_t count) {
+    m_zones[zone].nanoseconds.fetch_add(end - start,
+                                        std::memory_order_relaxed);
+    m_zones[zone].calls.fetch_add(1, std::memory_order_relaxed);
+
+    TraceBuffer& buffer = threadBuffer();
+    uint64_t i = buffer.written.load(std::memory_order_relaxed);
+    buffer.events[i % TraceBuffer::CAPACITY] = {start, end, count, zone};
+    buffer.written.store(i + 1, std::memory_order_release);
+}
+
+void Profiler::addCounters(int zone, const uint64_t* deltas, int64_t count) {
+    Zone& z = m_zones[zone];
+    for (int i = 0; i < PerfCounters::COUNT; i++)
+        z.counters[i].fetch_add(deltas[i], std::memory_order_relaxed);
+    if (count > 0) z.entities.fetch_add(count, std::memory_order_relaxed);
+}
+
+void Profiler::setThreadName(const std::string& name) {
+    TraceBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    buffer.name = name;
+}
+
+bool Profiler::writeTrace(const std::string& path, float seconds) {
+    std::ofstream out(path);
+    if (!out) return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t end = now();
+    uint64_t since = end - std::min<uint64_t>(end, seconds * 1e9);
+    uint64_t origin = end;
+    for (auto& buffer : m_buffers) {
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t first = written - std::min<uint64_t>(written,
+                                                      TraceBuffer::CAPACITY);
+        for (uint64_t i = first; i < written; i++) {
+            const TraceEvent& e = buffer->events[i % TraceBuffer::CAPACITY];
+            if (e.end >= since) origin = std::min(origin, e.start);
+        }
+    }
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (size_t t = 0; t < m_buffers.size(); t++) {
+        TraceBuffer& buffer = *m_buffers[t];
+        out << (first ? "" : ",\n")
+            << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+            << t << ",\"args\":{\"name\":\"" << buffer.name << "\"}}";
+        first = false;
+
+        uint64_t written = buffer.written.load(std::memory_order_acquire);
+        uint64_t begin = written - std::min<uint64_t>(written,
+                                                      TraceBuffer::CAPACITY);
+        for (uint64_t i = begin; i < written; i++) {
+            const TraceEvent& e = buffer.events[i % TraceBuffer::CAPACITY];
+            if (e.end < since) continue;
+            out << ",\n{\"name\":\"" << m_zones[e.zone].name
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << t
+                << ",\"ts\":" << (e.start - origin) / 1e3
+                << ",\"dur\":" << (e.end - e.start) / 1e3;
+            if (e.count >= 0)
+                out << ",\"args\":{\"count\":" << e.count << "}";
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+    return (bool)out;
+}
+
+void Profiler::endFrame() {
+    int slot = m_frames % HISTORY;
+    for (int i = 0; i < m_zoneCount.load(); i++) {
+        Zone& z = m_zones[i];
+        z.history[slot] = z.nanoseconds.exchange(0) / 1e6f;
+        z.lastCalls = z.calls.exchange(0);
+        for (int c = 0; c < PerfCounters::COUNT; c++)
+            z.lastCounters.values[c] = z.counters[c].exchange(0);
+        z.lastCounters.entities = z.entities.exchange(0);
+    }
+    for (AllocationCounter& a : m_allocations) {
+        a.lastCount = a.count.exchange(0);
+        a.lastBytes = a.bytes.exchange(0);
+        a.totalCount += a.lastCount;
+        a.totalBytes += a.lastBytes;
+    }
+    m_frames++;
+}
+
+int Profiler::zoneCount() const { return m_zoneCount.load(); }
+
+const std::string& Profiler::name(int zone) const { return m_zones[zone].name; }
+
+Profiler::Stats Profiler::stats(int zone) const {
+    const Zone& z = m_zones[zone];
+    int n = std::min<uint64_t>(m_frames, HISTORY);
+    Stats s;
+    if (n == 0) return s;
+
+    float sorted[HISTORY];
+    std::copy(z.history, z.history + n, sorted);
+    std::sort(sorted, sorted + n);
+    float sum = 0;
+    for (int i = 0; i < n; i++) sum += sorted[i];
+
+    s.last = z.history[(m_frames - 1) % HISTORY];
+    s.min = sorted[0];
+    s.avg = sum / n;
+    s.p99 = sorted[std::min(n - 1, (int)(n * 0.99f))];
+    s.max = sorted[n - 1];
+    s.calls = z.lastCalls;
+    return s;
+}
+
+void Profiler::countAllocation(size_t bytes) {
+    AllocationCounter& a = get().m_allocations[t_zone + 1];
+    a.count.fetch_add(1, std::memory_order_relaxed);
+    a.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+Profiler::AllocationStats Profiler::allocations(int zone) const {
+    const AllocationCounter& a = m_allocations[zone + 1];
+    AllocationStats s;
+    s.count = a.lastCount;
+    s.bytes = a.lastBytes;
+    if (m_frames > 0) {
+        s.avgCount = (double)a.totalCount / m_frames;
+        s.avgBytes = (double)a.totalBytes / m_frames;
+    }
+    return s;
+}
+
+Profiler::CounterStats Profiler::counters(int zone) const {
+    return m_zones[zone].lastCounters;
+}
+
+const float* Profiler::history(int zone) const { return m_zones[zone].history; }
+
+int Profiler::historyOffset() const {
+    return m_frames < HISTORY ? 0 : m_frames % HISTORY;
+}
+
+// The counters are read outside the timed span, so that the reads don't
+// show up in the zone's own time.
+ProfileScope::ProfileScope(int zone, int64_t count)
+    : m_zone(zone), m_count(count) {
+    PerfCounters& counters = PerfCounters::get();
+    m_counting = counters.enabled() && counters.read(m_counters);
+#if ALLOC_TRACKING
+    m_parent = t_zone;
+    t_zone = zone;
+#endif
+    m_start = Profiler::now();
+}
+
+ProfileScope::~ProfileScope() {
+    uint64_t end = Profiler::now();
+#if ALLOC_TRACKING
+    t_zone = m_parent;
+#endif
+    Profiler& profiler = Profiler::get();
+    profiler.add(m_zone, m_start, end, m_count);
+
+    uint64_t counters[PerfCounters::COUNT];
+    if (m_counting && PerfCounters::get().read(counters)) {
+        for (int i = 0; i < PerfCounters::COUNT; i++)
+            counters[i] -= m_counters[i];
+        profiler.addCounters(m_zone, counters, m_count);
+    }
+}
+
+#if ALLOC_TRACKING
+static void* allocate(size_t size, size_t alignment) {
+    Profiler::countAllocation(size);
+    if (size == 0) size = 1;
+    size_t rounded = (size + alignment - 1) & ~(alignment - 1);
+    void* p = alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__
+                  ? std::malloc(size)
+                  : std::aligned_alloc(alignment, rounded);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size) { return allocate(size, 0); }
+void* operator new[](size_t size) { return allocate(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) {
+    return allocate(size, (size_t)alignment);
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return allocate(size, (size_t)alignment);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+#endif
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "PerfCounters.h"
+
+// Building with PROFILER_ENABLED=0 (make PROFILER=0) removes every zone.
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+// Building with ALLOC_TRACKING=1 (make ALLOCS=1) replaces the global operator
+// new and delete to count allocations per zone.
+#ifndef ALLOC_TRACKING
+#define ALLOC_TRACKING 0
+#endif
+
+// Named timing zones. Each zone adds up its time over a frame; endFrame()
+// moves the totals into a short history the profiler tab draws from.
+// Zones may be entered from several threads at once.
+//
+// Every finished zone is also appended to a ring buffer owned by the thread
+// that ran it, for Chrome trace export. Only the owning thread writes its
+// buffer; writeTrace() reads up to the published write index, so it should
+// run while no jobs are in flight or the oldest events may be torn.
+//
+// With allocation tracking, every allocation is charged to the innermost zone
+// open on the allocating thread, or to no zone (-1) if there is none.
+//
+// While PerfCounters are enabled, every zone also reads the hardware counters
+// of its thread on entry and exit and adds up the difference.
+class Profiler {
+   public:
+    static const int MAX_ZONES = 64;
+    static const int HISTORY = 256;
+
+    struct Stats {
+        float last = 0, min = 0, avg = 0, p99 = 0, max = 0;
+        int calls = 0;
+    };
+
+    struct AllocationStats {
+        uint64_t count = 0, bytes = 0;  // last frame
+        double avgCount = 0, avgBytes = 0;  // per frame since the start
+    };
+
+    // Hardware counter totals of the last frame. entities adds up the count
+    // given to each counted scope.
+    struct CounterStats {
+        uint64_t values[PerfCounters::COUNT] = {};
+        uint64_t entities = 0;
+    };
+
+   private:
+    struct TraceEvent {
+        uint64_t start, end;
+        int64_t count;
+        int32_t zone;
+    };
+    struct TraceBuffer {
+        static constexpr size_t CAPACITY = 1 << 16;
+        TraceEvent events[CAPACITY];
+        std::atomic<uint64_t> written{0};
+        std::string name;
+    };
+
+    struct Zone {
+        std::string name;
+        std::atomic<uint64_t> nanoseconds{0};
+        std::atomic<uint32_t> calls{0};
+        float history[HISTORY] = {};
+        int lastCalls = 0;
+        std::atomic<uint64_t> counters[PerfCounters::COUNT] = {};
+        std::atomic<uint64_t> entities{0};
+        CounterStats lastCounters;
+    };
+
+    struct AllocationCounter {
+        std::atomic<uint64_t> count{0}, bytes{0};
+        uint64_t lastCount = 0, lastBytes = 0;
+        uint64_t totalCount = 0, totalBytes = 0;
+    };
+
+    Zone m_zones[MAX_ZONES];
+    // Indexed by zone + 1, so that slot 0 holds the allocations outside zones.
+    AllocationCounter m_allocations[MAX_ZONES + 1];
+    std::atomic<int> m_zoneCount{0};
+    std::mutex m_mutex;
+    uint64_t m_frames = 0;
+    std::vector<std::unique_ptr<TraceBuffer>> m_buffers;
+
+    Profiler();
+    TraceBuffer& threadBuffer();
+
+   public:
+    static Profiler& get();
+    static uint64_t now();
+
+    // Returns the id of the zone with this name, creating it if needed.
+    int zone(const char* name);
+    void add(int zone, uint64_t start, uint64_t end, int64_t count = -1);
+    void addCounters(int zone, const uint64_t* deltas, int64_t count);
+    void endFrame();
+
+    // Names the calling thread in traces.
+    void setThreadName(const std::string& name);
+    // Writes the zones that ended in the last seconds as Chrome trace_event
+    // JSON, viewable in chrome://tracing or ui.perfetto.dev.
+    bool writeTrace(const std::string& path, float seconds);
+
+    int zoneCount() const;
+    const std::string& name(int zone) const;
+    Stats stats(int zone) const;
+
+    // Charges an allocation to the innermost zone of the calling thread. Must
+    // not allocate itself, as it runs inside operator new.
+    static void countAllocation(size_t bytes);
+    // zone -1 gives the allocations made outside every zone.
+    AllocationStats allocations(int zone) const;
+    CounterStats counters(int zone) const;
+
+    // The history in milliseconds, oldest sample at offset.
+    const float* history(int zone) const;
+    int historyOffset() const;
+};
+
+// count, if not negative, is attached to the zone in traces as the number of
+// entities (or particles, or jobs) it worked on.
+class ProfileScope {
+    int m_zone;
+    int64_t m_count;
+    uint64_t m_start;
+    bool m_counting;
+    uint64_t m_counters[PerfCounters::COUNT];
+#if ALLOC_TRACKING
+    int m_parent;
+#endif
+
+   public:
+    ProfileScope(int zone, int64_t count = -1);
+    ~ProfileScope();
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+
+#if PROFILER_ENABLED
+#define PROFILE_ZONE_N(name, count)                             \
+    static const int PROFILE_CONCAT(profileZone, __LINE__) =    \
+        Profiler::get().zone(name);                             \
+    ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(        \
+        PROFILE_CONCAT(profileZone, __LINE__), (count))
+#else
+#define PROFILE_ZONE_N(name, count)
+#endif
+#define PROFILE_ZONE(name) PROFILE_ZONE_N(name, -1)
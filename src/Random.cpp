@@ -0,0 +1,56 @@
+#include "Random.h"
+
+RandomStream::RandomStream(uint64_t seed, uint64_t stream) {
+    m_state = 0;
+    m_inc = (stream << 1) | 1;
+    next();
+    m_state += seed;
+    next();
+}
+
+uint32_t RandomStream::next() {
+    uint64_t old = m_state;
+    m_state = old * 6364136223846793005ULL + m_inc;
+    uint32_t xorshifted = ((old >> 18) ^ old) >> 27;
+    uint32_t rot = old >> 59;
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+int RandomStream::range(int a, int b) {
+    uint32_t span = (uint32_t)(b - a) + 1;
+    return a + (int)(((uint64_t)next() * span) >> 32);
+}
+
+float RandomStream::uniform() { return (next() >> 8) * (1.0f / 16777216.0f); }
+
+void RandomStream::range(int* out, const int* lo, const int* hi, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = (int)next();
+    for (size_t i = 0; i < n; i++) {
+        uint32_t span = (uint32_t)(hi[i] - lo[i]) + 1;
+        out[i] = lo[i] + (int)(((uint64_t)(uint32_t)out[i] * span) >> 32);
+    }
+}
+
+// splitmix64 finaliser, so nearby seeds and stream ids give unrelated
+// starting states.
+static uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+RandomService::RandomService(uint64_t seed) : m_seed(seed) {}
+
+void RandomService::seed(uint64_t seed) { m_seed = seed; }
+
+uint64_t RandomService::seed() const { return m_seed; }
+
+RandomStream RandomService::stream(const std::string& name,
+                                   uint64_t index) const {
+    // FNV-1a of the name picks the sequence.
+    uint64_t id = 14695981039346656037ULL;
+    for (char c : name) id = (id ^ (unsigned char)c) * 1099511628211ULL;
+    id = mix(id ^ mix(index));
+    return RandomStream(mix(m_seed ^ id), id);
+}
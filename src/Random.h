@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// PCG32 (pcg-random.org): 64 bits of state and 32-bit output. Two streams
+// with different increments are independent sequences, even with the same
+// seed.
+class RandomStream {
+    uint64_t m_state = 0;
+    uint64_t m_inc = 1;
+
+   public:
+    RandomStream(uint64_t seed = 0, uint64_t stream = 0);
+
+    uint32_t next();
+
+    // Uniform integer in [a, b], for b - a below 2^32 - 1. Uses a multiply
+    // and shift instead of a modulo; the bias is at most (b - a + 1) / 2^32.
+    int range(int a, int b);
+
+    // Uniform float in [0, 1).
+    float uniform();
+
+    // out[i] = range(lo[i], hi[i]) for every i, drawn in the same order as n
+    // separate calls would. The raw values are generated first and mapped in
+    // a second loop without branches, which the compiler can vectorise.
+    void range(int* out, const int* lo, const int* hi, size_t n);
+};
+
+// Derives every stream from one master seed, so a run is reproducible from
+// that seed alone. Each system asks for its own named stream. Work split
+// across threads should take one stream per chunk index rather than per
+// thread, so the result does not depend on which worker ran which chunk.
+class RandomService {
+    uint64_t m_seed = 0;
+
+   public:
+    RandomService(uint64_t seed = 0);
+
+    void seed(uint64_t seed);
+    uint64_t seed() const;
+
+    RandomStream stream(const std::string& name, uint64_t index = 0) const;
+};
@@ -0,0 +1,185 @@
+#include "SamplingProfiler.h"
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+SamplingProfiler::SamplingProfiler() {}
+
+SamplingProfiler& SamplingProfiler::get() {
+    static SamplingProfiler profiler;
+    return profiler;
+}
+
+// Reads the interrupted instruction, frame and stack pointers out of the
+// signal context, then follows the chain of saved frame pointers. Each
+// frame starts with the caller's frame pointer followed by the return
+// address. A frame pointer is only trusted if it lies above the previous one
+// and not too far from it, so a register that holds something else in code
+// built without frame pointers ends the walk instead of crashing it.
+static int unwind(void* context, uint64_t* stack, int maxDepth) {
+    const ucontext_t* uc = (const ucontext_t*)context;
+#if defined(__x86_64__)
+    uintptr_t ip = uc->uc_mcontext.gregs[REG_RIP];
+    uintptr_t fp = uc->uc_mcontext.gregs[REG_RBP];
+    uintptr_t sp = uc->uc_mcontext.gregs[REG_RSP];
+#elif defined(__aarch64__)
+    uintptr_t ip = uc->uc_mcontext.pc;
+    uintptr_t fp = uc->uc_mcontext.regs[29];
+    uintptr_t sp = uc->uc_mcontext.sp;
+#else
+    return 0;
+#endif
+    const uintptr_t MAX_FRAME = 1 << 20;
+    int depth = 0;
+    stack[depth++] = ip;
+    uintptr_t low = sp;
+    while (depth < maxDepth) {
+        if (fp < low || fp - low > MAX_FRAME || fp % sizeof(uintptr_t))
+            break;
+        const uintptr_t* frame = (const uintptr_t*)fp;
+        uintptr_t ret = frame[1];
+        if (ret < 4096) break;
+        // Point into the call instruction, so it is attributed to the caller
+        // even when the call is the last instruction of a function.
+        stack[depth++] = ret - 1;
+        low = fp + 2 * sizeof(uintptr_t);
+        fp = frame[0];
+    }
+    return depth;
+}
+
+void SamplingProfiler::handler(int, siginfo_t*, void* context) {
+    int savedErrno = errno;
+    SamplingProfiler& p = get();
+    uint64_t stack[MAX_DEPTH];
+    int depth = unwind(context, stack, MAX_DEPTH);
+    size_t at = p.m_used.fetch_add(depth + 1, std::memory_order_relaxed);
+    if (at + depth + 1 > CAPACITY) {
+        p.m_dropped.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        p.m_buffer[at] = depth;
+        memcpy(&p.m_buffer[at + 1], stack, depth * sizeof(uint64_t));
+        p.m_samples.fetch_add(1, std::memory_order_relaxed);
+    }
+    errno = savedErrno;
+}
+
+bool SamplingProfiler::start(int hz) {
+    if (m_running) {
+        m_error = "already running";
+        return false;
+    }
+    if (hz <= 0) {
+        m_error = "the rate must be positive";
+        return false;
+    }
+    // Zeroed, so that space reserved by a sample that overflowed reads as
+    // empty records.
+    m_buffer.reset(new uint64_t[CAPACITY]());
+    m_used = 0;
+    m_samples = 0;
+    m_dropped = 0;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = handler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, nullptr) != 0) {
+        m_error = std::string("sigaction failed: ") + strerror(errno);
+        return false;
+    }
+
+    itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = std::max(1, 1000000 / hz);
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        m_error = std::string("setitimer failed: ") + strerror(errno);
+        signal(SIGPROF, SIG_IGN);
+        return false;
+    }
+    m_error.clear();
+    m_running = true;
+    return true;
+}
+
+void SamplingProfiler::stop() {
+    if (!m_running) return;
+    itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    signal(SIGPROF, SIG_IGN);
+    // Let a handler that was already running on another thread finish.
+    usleep(10000);
+    m_running = false;
+}
+
+const std::string& SamplingProfiler::error() const { return m_error; }
+
+uint64_t SamplingProfiler::samples() const { return m_samples.load(); }
+
+uint64_t SamplingProfiler::dropped() const { return m_dropped.load(); }
+
+static std::string symbolize(uint64_t address) {
+    Dl_info info;
+    char text[64];
+    if (dladdr((void*)address, &info) && info.dli_sname) {
+        int status;
+        char* demangled =
+            abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        std::string name = status == 0 ? demangled : info.dli_sname;
+        free(demangled);
+        return name;
+    }
+    if (info.dli_fname) {
+        const char* file = strrchr(info.dli_fname, '/');
+        snprintf(text, sizeof(text), "+0x%llx",
+                 (unsigned long long)(address - (uintptr_t)info.dli_fbase));
+        return std::string(file ? file + 1 : info.dli_fname) + text;
+    }
+    snprintf(text, sizeof(text), "0x%llx", (unsigned long long)address);
+    return text;
+}
+
+bool SamplingProfiler::writeCollapsed(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out || !m_buffer) return false;
+
+    std::unordered_map<uint64_t, std::string> names;
+    std::map<std::string, uint64_t> stacks;
+    size_t used = std::min(m_used.load(), CAPACITY);
+    for (size_t at = 0; at < used;) {
+        uint64_t depth = m_buffer[at];
+        if (depth == 0 || depth > MAX_DEPTH || at + 1 + depth > used) {
+            at++;
+            continue;
+        }
+        std::string line;
+        for (uint64_t i = depth; i > 0; i--) {
+            uint64_t address = m_buffer[at + i];
+            auto it = names.find(address);
+            if (it == names.end())
+                it = names.emplace(address, symbolize(address)).first;
+            if (!line.empty()) line += ';';
+            line += it->second;
+        }
+        stacks[line]++;
+        at += 1 + depth;
+    }
+    for (auto& [stack, count] : stacks) out << stack << ' ' << count << '\n';
+    return (bool)out;
+}
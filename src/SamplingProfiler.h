@@ -0,0 +1,53 @@
+#pragma once
+
+#include <signal.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Statistical profiler. setitimer(ITIMER_PROF) sends SIGPROF after every
+// 1/hz seconds of CPU time the process uses, to whichever thread is running.
+// The handler walks that thread's frame pointers and appends the return
+// addresses to a preallocated buffer, reserving its space with one atomic
+// add, so it neither locks nor allocates. Samples that don't fit are
+// dropped and counted.
+//
+// Stacks are only complete through code built with -fno-omit-frame-pointer,
+// which the Makefile passes; a frame in a library built without it usually
+// ends the stack there. Names come from dladdr, so the executable has to be
+// linked with -rdynamic; static functions show up as geowar+0xoffset,
+// which addr2line can resolve.
+class SamplingProfiler {
+    static constexpr size_t CAPACITY = 1 << 21;  // words
+    static const int MAX_DEPTH = 64;
+
+    std::unique_ptr<uint64_t[]> m_buffer;
+    std::atomic<size_t> m_used{0};
+    std::atomic<uint64_t> m_samples{0};
+    std::atomic<uint64_t> m_dropped{0};
+    bool m_running = false;
+    std::string m_error;
+
+    SamplingProfiler();
+    static void handler(int signal, siginfo_t* info, void* context);
+
+   public:
+    static SamplingProfiler& get();
+
+    // Returns false and sets error() if the profiler is already running, hz
+    // is not positive or the signal handler or timer can't be installed.
+    bool start(int hz);
+    void stop();
+    const std::string& error() const;
+
+    uint64_t samples() const;
+    uint64_t dropped() const;
+
+    // Writes one line per distinct stack, root first, frames separated by
+    // semicolons and followed by the number of samples: the collapsed format
+    // of flamegraph.pl, speedscope and inferno.
+    bool writeCollapsed(const std::string& path) const;
+};
@@ -0,0 +1,103 @@
+#include "Scheduler.h"
+
+#include <chrono>
+
+SystemScheduler::SystemScheduler() {}
+
+void SystemScheduler::add(const std::string& name, unsigned reads,
+                          unsigned writes, std::function<void()> run,
+                          bool* enabled) {
+    System s;
+    s.name = name;
+    s.reads = reads;
+    s.writes = writes;
+    s.run = run;
+    s.enabled = enabled;
+    m_systems.push_back(s);
+}
+
+// Keeps only the edges that are not implied by a longer path, which is
+// enough to preserve the ordering and much easier to read in the GUI.
+void SystemScheduler::build() {
+    size_t n = m_systems.size();
+    std::vector<std::vector<bool>> reach(n, std::vector<bool>(n, false));
+
+    for (size_t j = 0; j < n; j++) {
+        const System& b = m_systems[j];
+        for (size_t i = 0; i < j; i++) {
+            const System& a = m_systems[i];
+            if ((a.writes & (b.reads | b.writes)) || (b.writes & a.reads))
+                reach[i][j] = true;
+        }
+    }
+    for (size_t k = 0; k < n; k++)
+        for (size_t i = 0; i < n; i++)
+            if (reach[i][k])
+                for (size_t j = 0; j < n; j++)
+                    if (reach[k][j]) reach[i][j] = true;
+
+    m_dependents.assign(n, {});
+    m_pending.reset();
+    for (size_t j = 0; j < n; j++) {
+        m_systems[j].dependencies.clear();
+        for (size_t i = 0; i < j; i++) {
+            if (!reach[i][j]) continue;
+            bool implied = false;
+            for (size_t k = i + 1; k < j && !implied; k++)
+                implied = reach[i][k] && reach[k][j];
+            if (implied) continue;
+            m_systems[j].dependencies.push_back(i);
+            m_dependents[i].push_back(j);
+        }
+    }
+}
+
+void SystemScheduler::execute(size_t i) {
+    System& s = m_systems[i];
+    if (s.enabled && !*s.enabled) {
+        s.milliseconds = 0;
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    s.run();
+    std::chrono::duration<float, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    s.milliseconds = elapsed.count();
+}
+
+void SystemScheduler::dispatch(size_t i) {
+    Job job;
+    job.function = runJob;
+    job.data = this;
+    job.begin = i;
+    job.counter = &m_remaining;
+    m_jobs->submit(job);
+}
+
+// Dependents are submitted before this job's counter is released, so the
+// counter cannot reach zero while systems are still outstanding.
+void SystemScheduler::runJob(void* data, size_t i, size_t) {
+    SystemScheduler* scheduler = static_cast<SystemScheduler*>(data);
+    scheduler->execute(i);
+    for (size_t d : scheduler->m_dependents[i])
+        if (--scheduler->m_pending[d] == 0) scheduler->dispatch(d);
+}
+
+void SystemScheduler::run(JobSystem& jobs) {
+    if (!parallel || jobs.size() == 1) {
+        for (size_t i = 0; i < m_systems.size(); i++) execute(i);
+        return;
+    }
+
+    m_jobs = &jobs;
+    if (!m_pending) m_pending.reset(new std::atomic<int>[m_systems.size()]);
+    for (size_t i = 0; i < m_systems.size(); i++)
+        m_pending[i] = m_systems[i].dependencies.size();
+    for (size_t i = 0; i < m_systems.size(); i++)
+        if (m_systems[i].dependencies.empty()) dispatch(i);
+    jobs.wait(m_remaining);
+}
+
+const std::vector<System>& SystemScheduler::systems() const {
+    return m_systems;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "JobSystem.h"
+
+// Data a system reads or writes. Two systems conflict when one of them
+// writes something the other touches.
+namespace Access {
+enum : unsigned {
+    Transform = 1 << 0,
+    Shape = 1 << 1,
+    Collision = 1 << 2,
+    Score = 1 << 3,
+    Lifespan = 1 << 4,
+    Input = 1 << 5,
+    Entities = 1 << 6,  // adds or destroys entities
+    Particles = 1 << 7,
+};
+}
+
+struct System {
+    std::string name;
+    unsigned reads = 0;
+    unsigned writes = 0;
+    std::function<void()> run;
+    bool* enabled = nullptr;
+    std::vector<size_t> dependencies;
+    float milliseconds = 0;
+};
+
+// Runs registered systems once per call. A system depends on every earlier
+// registered system it conflicts with; systems without a path between them
+// in that graph run concurrently as jobs.
+class SystemScheduler {
+    std::vector<System> m_systems;
+    std::vector<std::vector<size_t>> m_dependents;
+
+    JobSystem* m_jobs = nullptr;
+    std::unique_ptr<std::atomic<int>[]> m_pending;
+    JobCounter m_remaining{0};
+
+    void execute(size_t i);
+    void dispatch(size_t i);
+    static void runJob(void* data, size_t begin, size_t end);
+
+   public:
+    bool parallel = true;
+
+    SystemScheduler();
+
+    void add(const std::string& name, unsigned reads, unsigned writes,
+             std::function<void()> run, bool* enabled = nullptr);
+    void build();
+    void run(JobSystem& jobs);
+
+    const std::vector<System>& systems() const;
+};
@@ -0,0 +1,101 @@
+#include "ShapeBatch.h"
+
+#include <algorithm>
+
+ShapeBatch::ShapeBatch() {}
+
+const std::vector<Vec2>& ShapeBatch::unitPolygon(size_t points) {
+    if (points >= m_unitPolygons.size()) m_unitPolygons.resize(points + 1);
+
+    std::vector<Vec2>& polygon = m_unitPolygons[points];
+    if (polygon.empty()) {
+        for (size_t i = 0; i < points; i++) {
+            float theta = i * 2 * M_PI / points - M_PI / 2;
+            polygon.push_back(Vec2(cos(theta), sin(theta)));
+        }
+    }
+    return polygon;
+}
+
+void ShapeBatch::clear() {
+    m_vertices.clear();
+    m_fullVertexCount = 0;
+}
+
+void ShapeBatch::setLod(bool enabled, float radius, size_t points, bool all) {
+    m_lod = enabled;
+    m_lodRadius = radius;
+    m_lodPoints = std::max((size_t)3, points);
+    m_lodAll = all;
+}
+
+void ShapeBatch::addPolygon(const Vec2& pos, float radius, size_t points,
+                            float angle, const sf::Color& fill,
+                            const sf::Color& outline, float thickness) {
+    if (points < 3) return;
+    bool hasFill = true;
+    bool hasOutline = thickness > 0 && outline.a > 0;
+    m_fullVertexCount += points * (hasOutline ? 9 : 3);
+
+    // A shape that is only an outline keeps it and drops its transparent
+    // fill instead, or it would vanish.
+    if (m_lod && (m_lodAll || radius < m_lodRadius)) {
+        points = std::min(points, m_lodPoints);
+        if (hasOutline && fill.a == 0)
+            hasFill = false;
+        else
+            hasOutline = false;
+    }
+
+    const std::vector<Vec2>& polygon = unitPolygon(points);
+    float theta = angle * M_PI / 180.0;
+    float c = cos(theta), s = sin(theta);
+
+    // Outline vertices sit on the edges offset by the thickness, like the
+    // outline SFML builds for a regular polygon.
+    float outer = radius + thickness / cos(M_PI / points);
+
+    size_t first = m_vertices.size();
+    m_vertices.resize(first +
+                      points * ((hasFill ? 3 : 0) + (hasOutline ? 6 : 0)));
+    sf::Vertex* v = &m_vertices[first];
+
+    for (size_t i = 0; i < points; i++) {
+        const Vec2& a = polygon[i];
+        const Vec2& b = polygon[(i + 1) % points];
+        sf::Vector2f ra(a.x * c - a.y * s, a.x * s + a.y * c);
+        sf::Vector2f rb(b.x * c - b.y * s, b.x * s + b.y * c);
+
+        sf::Vector2f innerA(pos.x + ra.x * radius, pos.y + ra.y * radius);
+        sf::Vector2f innerB(pos.x + rb.x * radius, pos.y + rb.y * radius);
+
+        if (hasFill) {
+            *v++ = sf::Vertex(sf::Vector2f(pos.x, pos.y), fill);
+            *v++ = sf::Vertex(innerA, fill);
+            *v++ = sf::Vertex(innerB, fill);
+        }
+
+        if (hasOutline) {
+            sf::Vector2f outerA(pos.x + ra.x * outer, pos.y + ra.y * outer);
+            sf::Vector2f outerB(pos.x + rb.x * outer, pos.y + rb.y * outer);
+
+            *v++ = sf::Vertex(innerA, outline);
+            *v++ = sf::Vertex(outerA, outline);
+            *v++ = sf::Vertex(outerB, outline);
+            *v++ = sf::Vertex(innerA, outline);
+            *v++ = sf::Vertex(outerB, outline);
+            *v++ = sf::Vertex(innerB, outline);
+        }
+    }
+}
+
+size_t ShapeBatch::getVertexCount() const { return m_vertices.size(); }
+
+size_t ShapeBatch::getSavedVertexCount() const {
+    return m_fullVertexCount - m_vertices.size();
+}
+
+void ShapeBatch::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+    if (m_vertices.empty()) return;
+    target.draw(m_vertices.data(), m_vertices.size(), sf::Triangles, states);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+#include "Vec2.h"
+
+// Collects regular polygons into a single triangle list so they can be drawn
+// with one draw call. Polygons match the geometry of an sf::CircleShape with
+// its origin at the centre.
+//
+// With level of detail enabled, polygons smaller than the LOD radius (or all
+// of them when the batch is over budget) are drawn with at most the LOD point
+// count and without an outline. Shapes with a transparent fill keep their
+// outline and lose the fill instead.
+class ShapeBatch : public sf::Drawable {
+    std::vector<sf::Vertex> m_vertices;
+    std::vector<std::vector<Vec2>> m_unitPolygons;
+    size_t m_fullVertexCount = 0;
+
+    bool m_lod = false;
+    bool m_lodAll = false;
+    float m_lodRadius = 0;
+    size_t m_lodPoints = 0;
+
+    const std::vector<Vec2>& unitPolygon(size_t points);
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+   public:
+    ShapeBatch();
+
+    void clear();
+    void setLod(bool enabled, float radius, size_t points, bool all);
+    void addPolygon(const Vec2& pos, float radius, size_t points, float angle,
+                    const sf::Color& fill, const sf::Color& outline,
+                    float thickness);
+
+    size_t getVertexCount() const;
+    size_t getSavedVertexCount() const;
+};
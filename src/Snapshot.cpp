@@ -0,0 +1,56 @@
+#include "Snapshot.h"
+
+#include <fstream>
+
+Snapshot::Snapshot() {}
+
+void Snapshot::append(const void* data, size_t size) {
+    size_t offset = m_data.size();
+    m_data.resize(offset + size);
+    if (size) std::memcpy(&m_data[offset], data, size);
+}
+
+bool Snapshot::take(void* data, size_t size) {
+    if (size > m_data.size() - m_read) return false;
+    if (size) std::memcpy(data, &m_data[m_read], size);
+    m_read += size;
+    return true;
+}
+
+// Keeps the allocation, so taking snapshots repeatedly doesn't allocate.
+void Snapshot::clear() {
+    m_data.clear();
+    m_read = 0;
+}
+
+void Snapshot::rewind() { m_read = 0; }
+
+size_t Snapshot::size() const { return m_data.size(); }
+
+bool Snapshot::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    out.write(m_data.data(), m_data.size());
+    return (bool)out;
+}
+
+bool Snapshot::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+    m_data.resize(in.tellg());
+    m_read = 0;
+    in.seekg(0);
+    return (bool)in.read(m_data.data(), m_data.size());
+}
+
+void Snapshot::write(const std::string& value) {
+    write((uint64_t)value.size());
+    append(value.data(), value.size());
+}
+
+bool Snapshot::read(std::string& value) {
+    uint64_t n;
+    if (!read(n) || n > m_data.size() - m_read) return false;
+    value.assign(&m_data[m_read], n);
+    m_read += n;
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Binary blob for world snapshots. Values and whole arrays of trivially
+// copyable types are appended with memcpy and read back in the same order.
+// The layout is that of the host, so a snapshot is only valid for the build
+// that wrote it.
+class Snapshot {
+    std::vector<char> m_data;
+    size_t m_read = 0;
+
+    void append(const void* data, size_t size);
+    bool take(void* data, size_t size);
+
+   public:
+    Snapshot();
+
+    void clear();
+    void rewind();
+    size_t size() const;
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    template <class T>
+    void write(const T& value);
+    template <class T>
+    void write(const std::vector<T>& values);
+    void write(const std::string& value);
+
+    template <class T>
+    bool read(T& value);
+    template <class T>
+    bool read(std::vector<T>& values);
+    bool read(std::string& value);
+};
+
+template <class T>
+void Snapshot::write(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    append(&value, sizeof(T));
+}
+
+template <class T>
+void Snapshot::write(const std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    write((uint64_t)values.size());
+    append(values.data(), values.size() * sizeof(T));
+}
+
+template <class T>
+bool Snapshot::read(T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    return take(&value, sizeof(T));
+}
+
+template <class T>
+bool Snapshot::read(std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    uint64_t n;
+    if (!read(n) || n > (m_data.size() - m_read) / sizeof(T)) return false;
+    values.resize(n);
+    return take(values.data(), n * sizeof(T));
+}
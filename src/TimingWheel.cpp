@@ -0,0 +1,66 @@
+#include "TimingWheel.h"
+
+#include <algorithm>
+
+TimingWheel::TimingWheel() {}
+
+void TimingWheel::reset(uint64_t now) {
+    for (auto& level : m_slots)
+        for (auto& slot : level) slot.clear();
+    m_overflow.clear();
+    m_now = now;
+    m_size = 0;
+}
+
+// A timer due now goes to the current level 0 slot, which advance() empties
+// right after cascading.
+void TimingWheel::insert(Timer&& timer) {
+    uint64_t delta = timer.expiry - m_now;
+    for (int level = 0; level < LEVELS; level++) {
+        if (delta < (uint64_t)1 << (BITS * (level + 1))) {
+            size_t slot = (timer.expiry >> (BITS * level)) & (SLOTS - 1);
+            m_slots[level][slot].push_back(std::move(timer));
+            return;
+        }
+    }
+    m_overflow.push_back(std::move(timer));
+}
+
+// Re-inserts the timers of the slot of this level that the current tick has
+// just reached; they all land on lower levels.
+void TimingWheel::cascade(int level) {
+    size_t slot = (m_now >> (BITS * level)) & (SLOTS - 1);
+    m_cascade.swap(m_slots[level][slot]);
+    for (auto& timer : m_cascade) insert(std::move(timer));
+    m_cascade.clear();
+}
+
+void TimingWheel::schedule(const std::shared_ptr<Entity>& entity,
+                           uint64_t expiry) {
+    insert({entity, std::max(expiry, m_now + 1)});
+    m_size++;
+}
+
+void TimingWheel::advance(uint64_t tick,
+                          std::vector<std::shared_ptr<Entity>>& expired) {
+    while (m_now < tick) {
+        m_now++;
+        for (int level = 1; level < LEVELS; level++) {
+            if (m_now & (((uint64_t)1 << (BITS * level)) - 1)) break;
+            cascade(level);
+            if (level == LEVELS - 1 &&
+                !(m_now & (((uint64_t)1 << (BITS * LEVELS)) - 1))) {
+                m_cascade.swap(m_overflow);
+                for (auto& timer : m_cascade) insert(std::move(timer));
+                m_cascade.clear();
+            }
+        }
+
+        auto& due = m_slots[0][m_now & (SLOTS - 1)];
+        for (auto& timer : due) expired.push_back(std::move(timer.entity));
+        m_size -= due.size();
+        due.clear();
+    }
+}
+
+size_t TimingWheel::size() const { return m_size; }
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Entity.h"
+
+// Hierarchical timing wheel keyed by absolute tick. Level 0 has one slot per
+// tick for the next 64 ticks, each further level covers 64 times the range
+// of the one below. A timer cascades to a lower level whenever the lower
+// level wraps around, so advancing one tick only touches the timers that
+// are due and, every 64 ticks, one slot of the level above.
+class TimingWheel {
+    static const int BITS = 6;
+    static const int SLOTS = 1 << BITS;
+    static const int LEVELS = 4;
+
+    struct Timer {
+        std::shared_ptr<Entity> entity;
+        uint64_t expiry;
+    };
+
+    std::vector<Timer> m_slots[LEVELS][SLOTS];
+    std::vector<Timer> m_overflow;
+    std::vector<Timer> m_cascade;
+    uint64_t m_now = 0;
+    size_t m_size = 0;
+
+    void insert(Timer&& timer);
+    void cascade(int level);
+
+   public:
+    TimingWheel();
+
+    // Drops every timer and sets the current tick.
+    void reset(uint64_t now);
+
+    // Timers due at or before the current tick fire on the next advance.
+    void schedule(const std::shared_ptr<Entity>& entity, uint64_t expiry);
+
+    // Moves the wheel forward to tick and appends the entities that became
+    // due to expired.
+    void advance(uint64_t tick, std::vector<std::shared_ptr<Entity>>& expired);
+
+    size_t size() const;
+};
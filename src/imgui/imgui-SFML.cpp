@@ -10,6 +10,7 @@
 #include <SFML/Graphics/Texture.hpp>
 #include <SFML/OpenGL.hpp>
 #include <SFML/Window/Clipboard.hpp>
+#include <SFML/Window/Context.hpp>
 #include <SFML/Window/Cursor.hpp>
 #include <SFML/Window/Event.hpp>
 #include <SFML/Window/Touch.hpp>
@@ -19,10 +20,12 @@
 #include <cmath> // abs
 #include <cstddef> // offsetof, nullptr, size_t
 #include <cstdint> // uint8_t
+#include <cstdio> // sscanf
 #include <cstring> // memcpy
 
 #include <algorithm>
 #include <memory>
+#include <string>
 #include <vector>
 
 #if defined(__APPLE__)
@@ -116,6 +119,29 @@ int closeKeyboardIME() {
 static_assert(sizeof(GLuint) <= sizeof(ImTextureID),
               "ImTextureID is not large enough to fit GLuint.");
 
+// Buffer objects are OpenGL 1.5, but the system headers only guarantee 1.1 on some platforms,
+// so the entry points are loaded at runtime and the constants defined here if missing.
+// Define IMGUI_SFML_LEGACY_RENDERER to always use the client-side array renderer.
+#if !defined(GL_VERSION_ES_CL_1_1) && !defined(IMGUI_SFML_LEGACY_RENDERER)
+#if defined(_WIN32)
+#define IMGUI_SFML_GLAPI __stdcall
+#else
+#define IMGUI_SFML_GLAPI
+#endif
+
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#endif
+#ifndef GL_ELEMENT_ARRAY_BUFFER
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+
+#define IMGUI_SFML_HAS_VBO_RENDERER 1
+#endif
+
 namespace {
 // various helper functions
 ImColor toImColor(sf::Color c);
@@ -126,6 +152,10 @@ ImTextureID convertGLTextureHandleToImTextureID(GLuint glTextureHandle);
 GLuint convertImTextureIDToGLTextureHandle(ImTextureID textureID);
 
 void RenderDrawLists(ImDrawData* draw_data); // rendering callback function prototype
+#ifdef IMGUI_SFML_HAS_VBO_RENDERER
+bool loadBufferFunctions();
+void RenderDrawListsVbo(ImDrawData* draw_data); // buffer object variant of RenderDrawLists
+#endif
 
 // Default mapping is XInput gamepad mapping
 void initDefaultJoystickMapping();
@@ -194,6 +224,14 @@ struct WindowContext {
     sf::Cursor mouseCursors[ImGuiMouseCursor_COUNT];
     bool mouseCursorLoaded[ImGuiMouseCursor_COUNT] = {ImGuiKey_None};
 
+#ifdef IMGUI_SFML_HAS_VBO_RENDERER
+    // streaming vertex/index buffers, reused every frame and grown on demand
+    GLuint vertexBuffer{0};
+    GLuint indexBuffer{0};
+    std::size_t vertexBufferSize{0};
+    std::size_t indexBufferSize{0};
+#endif
+
 #ifdef ANDROID
 #ifdef USE_JNI
     bool wantTextInput{false};
@@ -201,7 +239,7 @@ struct WindowContext {
 #endif
 
     WindowContext(const sf::Window* w) : window(w), windowHasFocus(window->hasFocus()) {}
-    ~WindowContext() { ImGui::DestroyContext(imContext); }
+    ~WindowContext();
 
     WindowContext(const WindowContext&) = delete; // non construction-copyable
     WindowContext& operator=(const WindowContext&) = delete; // non copyable
@@ -210,6 +248,31 @@ struct WindowContext {
 std::vector<std::unique_ptr<WindowContext>> s_windowContexts;
 WindowContext* s_currWindowCtx = nullptr;
 
+#ifdef IMGUI_SFML_HAS_VBO_RENDERER
+struct BufferFunctions {
+    void(IMGUI_SFML_GLAPI* genBuffers)(GLsizei, GLuint*){nullptr};
+    void(IMGUI_SFML_GLAPI* deleteBuffers)(GLsizei, const GLuint*){nullptr};
+    void(IMGUI_SFML_GLAPI* bindBuffer)(GLenum, GLuint){nullptr};
+    void(IMGUI_SFML_GLAPI* bufferData)(GLenum, std::ptrdiff_t, const void*, GLenum){nullptr};
+    void(IMGUI_SFML_GLAPI* bufferSubData)(GLenum, std::ptrdiff_t, std::ptrdiff_t,
+                                          const void*){nullptr};
+    bool loaded{false};
+    bool available{false};
+};
+BufferFunctions s_gl;
+#endif
+
+WindowContext::~WindowContext() {
+#ifdef IMGUI_SFML_HAS_VBO_RENDERER
+    if (vertexBuffer || indexBuffer) {
+        sf::Context context; // buffers are shared, any active context can release them
+        const GLuint buffers[2] = {vertexBuffer, indexBuffer};
+        s_gl.deleteBuffers(2, buffers);
+    }
+#endif
+    ImGui::DestroyContext(imContext);
+}
+
 } // end of anonymous namespace
 
 namespace ImGui {
@@ -473,6 +536,17 @@ void Render(sf::RenderWindow& window) {
 }
 
 void Render(sf::RenderTarget& target) {
+#ifdef IMGUI_SFML_HAS_VBO_RENDERER
+    // The buffer path only touches a handful of states and undoes them itself; resetGLStates()
+    // afterwards brings SFML's state cache back in sync instead of pushing/popping every GL
+    // attribute around the draw.
+    if (target.setActive(true) && loadBufferFunctions()) {
+        ImGui::Render();
+        RenderDrawListsVbo(ImGui::GetDrawData());
+        target.resetGLStates();
+        return;
+    }
+#endif
     target.resetGLStates();
     target.pushGLStates();
     ImGui::Render();
@@ -989,6 +1063,157 @@ void RenderDrawLists(ImDrawData* draw_data) {
 #endif
 }
 
+#ifdef IMGUI_SFML_HAS_VBO_RENDERER
+template<typename T>
+void loadGLFunction(T& function, const char* name) {
+    auto address = sf::Context::getFunction(name);
+    if (!address) address = sf::Context::getFunction((std::string(name) + "ARB").c_str());
+    function = reinterpret_cast<T>(address);
+}
+
+// Needs an active context. Returns false when buffer objects are unsupported, in which case the
+// client-side array renderer is used.
+bool loadBufferFunctions() {
+    if (s_gl.loaded) return s_gl.available;
+    s_gl.loaded = true;
+
+    // Some loaders return non-null for any name, so check the version before trusting them.
+    int major = 0, minor = 0;
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    if (!version || std::sscanf(version, "%d.%d", &major, &minor) != 2) return false;
+    if (major < 1 || (major == 1 && minor < 5)) return false;
+
+    loadGLFunction(s_gl.genBuffers, "glGenBuffers");
+    loadGLFunction(s_gl.deleteBuffers, "glDeleteBuffers");
+    loadGLFunction(s_gl.bindBuffer, "glBindBuffer");
+    loadGLFunction(s_gl.bufferData, "glBufferData");
+    loadGLFunction(s_gl.bufferSubData, "glBufferSubData");
+    s_gl.available = s_gl.genBuffers && s_gl.deleteBuffers && s_gl.bindBuffer && s_gl.bufferData &&
+                     s_gl.bufferSubData;
+    return s_gl.available;
+}
+
+// Same output as RenderDrawLists, but all command lists are uploaded into one pair of persistent
+// stream buffers per frame instead of being read from client memory on every draw call.
+//
+// State handling is deliberately minimal: only what SFML's resetGLStates() does not reset is
+// restored here (scissor test, buffer bindings and the matrix stacks), and polygon mode, shade
+// model and texture env mode are assumed to be at their GL defaults, which SetupRenderState
+// sets them to anyway.
+void RenderDrawListsVbo(ImDrawData* draw_data) {
+    if (draw_data->CmdListsCount == 0) {
+        return;
+    }
+
+    const ImGuiIO& io = ImGui::GetIO();
+    assert(io.Fonts->TexID != (ImTextureID) nullptr); // You forgot to create and set font texture
+
+    const int fb_width = (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
+    const int fb_height = (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
+    if (fb_width == 0 || fb_height == 0) return;
+    draw_data->ScaleClipRects(io.DisplayFramebufferScale);
+
+    WindowContext& ctx = *s_currWindowCtx;
+    if (!ctx.vertexBuffer) {
+        GLuint buffers[2] = {0, 0};
+        s_gl.genBuffers(2, buffers);
+        ctx.vertexBuffer = buffers[0];
+        ctx.indexBuffer = buffers[1];
+    }
+
+    const std::size_t vtx_size = (std::size_t)draw_data->TotalVtxCount * sizeof(ImDrawVert);
+    const std::size_t idx_size = (std::size_t)draw_data->TotalIdxCount * sizeof(ImDrawIdx);
+    if (vtx_size > ctx.vertexBufferSize)
+        ctx.vertexBufferSize = std::max(vtx_size, ctx.vertexBufferSize * 2);
+    if (idx_size > ctx.indexBufferSize)
+        ctx.indexBufferSize = std::max(idx_size, ctx.indexBufferSize * 2);
+
+    // Re-specifying the store orphans last frame's data, so the upload never waits on the GPU
+    s_gl.bindBuffer(GL_ARRAY_BUFFER, ctx.vertexBuffer);
+    s_gl.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ctx.indexBuffer);
+    s_gl.bufferData(GL_ARRAY_BUFFER, (std::ptrdiff_t)ctx.vertexBufferSize, nullptr,
+                    GL_STREAM_DRAW);
+    s_gl.bufferData(GL_ELEMENT_ARRAY_BUFFER, (std::ptrdiff_t)ctx.indexBufferSize, nullptr,
+                    GL_STREAM_DRAW);
+
+    std::size_t vtx_offset = 0;
+    std::size_t idx_offset = 0;
+    for (int n = 0; n < draw_data->CmdListsCount; n++) {
+        const ImDrawList* cmd_list = draw_data->CmdLists[n];
+        const std::size_t vtx_bytes = (std::size_t)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
+        const std::size_t idx_bytes = (std::size_t)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
+        s_gl.bufferSubData(GL_ARRAY_BUFFER, (std::ptrdiff_t)vtx_offset, (std::ptrdiff_t)vtx_bytes,
+                           cmd_list->VtxBuffer.Data);
+        s_gl.bufferSubData(GL_ELEMENT_ARRAY_BUFFER, (std::ptrdiff_t)idx_offset,
+                           (std::ptrdiff_t)idx_bytes, cmd_list->IdxBuffer.Data);
+        vtx_offset += vtx_bytes;
+        idx_offset += idx_bytes;
+    }
+
+    SetupRenderState(draw_data, fb_width, fb_height);
+
+    const ImVec2 clip_off = draw_data->DisplayPos;
+    const ImVec2 clip_scale = draw_data->FramebufferScale;
+
+    vtx_offset = 0;
+    idx_offset = 0;
+    for (int n = 0; n < draw_data->CmdListsCount; n++) {
+        const ImDrawList* cmd_list = draw_data->CmdLists[n];
+        const char* vtx_base = reinterpret_cast<const char*>(vtx_offset);
+        glVertexPointer(2, GL_FLOAT, sizeof(ImDrawVert), vtx_base + IM_OFFSETOF(ImDrawVert, pos));
+        glTexCoordPointer(2, GL_FLOAT, sizeof(ImDrawVert), vtx_base + IM_OFFSETOF(ImDrawVert, uv));
+        glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(ImDrawVert),
+                       vtx_base + IM_OFFSETOF(ImDrawVert, col));
+
+        for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++) {
+            const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
+            if (pcmd->UserCallback) {
+                if (pcmd->UserCallback == ImDrawCallback_ResetRenderState) {
+                    glMatrixMode(GL_MODELVIEW);
+                    glPopMatrix();
+                    glMatrixMode(GL_PROJECTION);
+                    glPopMatrix();
+                    SetupRenderState(draw_data, fb_width, fb_height);
+                } else
+                    pcmd->UserCallback(cmd_list, pcmd);
+            } else {
+                ImVec4 clip_rect;
+                clip_rect.x = (pcmd->ClipRect.x - clip_off.x) * clip_scale.x;
+                clip_rect.y = (pcmd->ClipRect.y - clip_off.y) * clip_scale.y;
+                clip_rect.z = (pcmd->ClipRect.z - clip_off.x) * clip_scale.x;
+                clip_rect.w = (pcmd->ClipRect.w - clip_off.y) * clip_scale.y;
+
+                if (clip_rect.x < static_cast<float>(fb_width) &&
+                    clip_rect.y < static_cast<float>(fb_height) && clip_rect.z >= 0.0f &&
+                    clip_rect.w >= 0.0f) {
+                    glScissor((int)clip_rect.x, (int)(static_cast<float>(fb_height) - clip_rect.w),
+                              (int)(clip_rect.z - clip_rect.x), (int)(clip_rect.w - clip_rect.y));
+
+                    glBindTexture(GL_TEXTURE_2D,
+                                  convertImTextureIDToGLTextureHandle(pcmd->TextureId));
+                    glDrawElements(GL_TRIANGLES, (GLsizei)pcmd->ElemCount,
+                                   sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+                                   reinterpret_cast<const void*>(
+                                       idx_offset + pcmd->IdxOffset * sizeof(ImDrawIdx)));
+                }
+            }
+        }
+        vtx_offset += (std::size_t)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
+        idx_offset += (std::size_t)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
+    }
+
+    // SFML draws from client memory, so the buffers must be unbound before it draws again
+    s_gl.bindBuffer(GL_ARRAY_BUFFER, 0);
+    s_gl.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glDisable(GL_SCISSOR_TEST);
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+}
+#endif
+
 unsigned int getConnectedJoystickId() {
     for (unsigned int i = 0; i < (unsigned int)sf::Joystick::Count; ++i) {
         if (sf::Joystick::isConnected(i)) return i;
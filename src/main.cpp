@@ -1,7 +1,74 @@
 #include <Game.h>
 
-int main(int argc, char *argv[]) { 
-    Game ecsGeometryWars("../bin/config.txt");
-    ecsGeometryWars.run();
-    return 0; 
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <string>
+
+static void usage(const char* program) {
+    std::cerr << "usage: " << program
+              << " [--headless] [--frames N] [--seed S] [--config PATH]"
+                 " [--record PATH | --replay PATH]"
+                 " [--load-snapshot PATH] [--save-snapshot PATH]"
+                 " [--soak N] [--trace PATH] [--trace-seconds N]"
+                 " [--perf-counters] [--frame-times PATH]"
+                 " [--sample PATH] [--sample-hz N] [--memory-report]\n";
+}
+
+int main(int argc, char* argv[]) {
+    GameOptions options;
+    options.seed = time(NULL);
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--headless")
+            options.headless = true;
+        else if (arg == "--frames" && hasValue)
+            options.frames = atoi(argv[++i]);
+        else if (arg == "--seed" && hasValue)
+            options.seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--config" && hasValue)
+            options.config = argv[++i];
+        else if (arg == "--record" && hasValue)
+            options.record = argv[++i];
+        else if (arg == "--replay" && hasValue)
+            options.replay = argv[++i];
+        else if (arg == "--load-snapshot" && hasValue)
+            options.loadSnapshot = argv[++i];
+        else if (arg == "--save-snapshot" && hasValue)
+            options.saveSnapshot = argv[++i];
+        else if (arg == "--soak" && hasValue)
+            options.soak = atoi(argv[++i]);
+        else if (arg == "--trace" && hasValue)
+            options.trace = argv[++i];
+        else if (arg == "--trace-seconds" && hasValue)
+            options.traceSeconds = atof(argv[++i]);
+        else if (arg == "--perf-counters")
+            options.perfCounters = true;
+        else if (arg == "--frame-times" && hasValue)
+            options.frameTimes = argv[++i];
+        else if (arg == "--sample" && hasValue)
+            options.sample = argv[++i];
+        else if (arg == "--sample-hz" && hasValue)
+            options.sampleHz = atoi(argv[++i]);
+        else if (arg == "--memory-report")
+            options.memoryReport = true;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if ((!options.record.empty() && !options.replay.empty()) ||
+        options.sampleHz <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    // A headless run has no window to close, so it needs an end. A replay
+    // ends with its recording.
+    if (options.headless && options.frames <= 0 && options.replay.empty())
+        options.frames = 3600;
+
+    Game ecsGeometryWars(options);
+    return ecsGeometryWars.run() ? 0 : 1;
 }